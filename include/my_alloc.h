@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Block-chained memory arena (MEM_ROOT). Small objects are carved out
+ * of large blocks and the whole arena is released at once.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_ALLOC_H
+#define __MY_ALLOC_H
+
+#include <stddef.h>
+#include "my_global_exports.h"
+
+C_MODE_START
+
+#ifndef MALLOC_OVERHEAD
+#define MALLOC_OVERHEAD         8
+#endif
+
+#define ALLOC_MAX_BLOCK_TO_DROP          4096
+#define ALLOC_MAX_BLOCK_USAGE_BEFORE_DROP 10
+
+#define ALLOC_ALIGN_SIZE        sizeof(double)
+#define ALLOC_ALIGN(A)          MY_ALIGN((A), ALLOC_ALIGN_SIZE)
+
+/* Flags for free_root() */
+#define MY_MARK_BLOCKS_FREE     2  /* Keep blocks, only mark them as free */
+#define MY_KEEP_PREALLOC        1  /* Keep the preallocated block */
+
+typedef struct my_used_mem_t
+{				   /* struct for once_alloc (block) */
+    struct my_used_mem_t* next;	   /* Next block in use */
+    size_t left;		   /* memory left in block  */
+    size_t size;		   /* size of block */
+} USED_MEM;
+
+#define ALLOC_ROOT_MIN_BLOCK_SIZE (MALLOC_OVERHEAD + sizeof(USED_MEM) + 8)
+
+typedef struct my_mem_root_t
+{
+    USED_MEM* free;                /* blocks with free memory in it */
+    USED_MEM* used;                /* blocks almost without free memory */
+    USED_MEM* pre_alloc;           /* preallocated block */
+    /* if block have less memory it will be put in 'used' list */
+    size_t min_malloc;
+    size_t block_size;             /* initial block size */
+    unsigned int block_num;        /* allocated blocks counter */
+    /*
+      first free block in queue test counter (if it exceed
+      ALLOC_MAX_BLOCK_USAGE_BEFORE_DROP block will be dropped in 'used' list)
+    */
+    unsigned int first_block_usage;
+    size_t allocated;              /* bytes currently held in blocks */
+    unsigned int tag;              /* my_malloc() tag the blocks are accounted to */
+    void (*error_handler)(void);
+} MEM_ROOT;
+
+#define alloc_root_inited(A) ((A)->min_malloc != 0)
+#define clear_alloc_root(A) do { (A)->free= (A)->used= (A)->pre_alloc= 0; (A)->min_malloc=0;} while(0)
+
+MY_GLOBAL_API void init_alloc_root(unsigned int tag, MEM_ROOT* mem_root, size_t block_size, size_t pre_alloc_size);
+
+MY_GLOBAL_API void* alloc_root(MEM_ROOT* mem_root, size_t length);
+
+MY_GLOBAL_API void free_root(MEM_ROOT* mem_root, int flags);
+
+MY_GLOBAL_API void reset_root_defaults(MEM_ROOT* mem_root, size_t block_size, size_t pre_alloc_size);
+
+MY_GLOBAL_API char* strdup_root(MEM_ROOT* mem_root, const char* str);
+
+MY_GLOBAL_API void* memdup_root(MEM_ROOT* mem_root, const void* str, size_t len);
+
+C_MODE_END
+
+#endif  //__MY_ALLOC_H
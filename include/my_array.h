@@ -16,26 +16,55 @@
 #define __MY_ARRAY_H
 
 #include "my_global_exports.h"
+#include "my_qsort.h"
+#include "my_scan.h"
 
 C_MODE_START
 
+#ifndef MALLOC_OVERHEAD
 #define MALLOC_OVERHEAD      8
+#endif
 #define ARRAT_BLOCK_SIZE     8096
 #define ARRAY_INIT_INCREMENT 16
 #define ARRAY_INIT_NUMBER    8
 
+/* Growth policies, see my_array_grow() */
+#define MY_ARRAY_GROW_FIXED     0   /* Add increment elements */
+#define MY_ARRAY_GROW_GEOMETRIC 1   /* Multiply by factor, add at least increment */
+#define MY_ARRAY_GROW_CAPPED    2   /* Geometric, add at most max_increment */
+
+#define MY_ARRAY_GROW_FACTOR    150 /* Default factor, in percent */
+#define MY_ARRAY_SHRINK_PERCENT 50  /* my_array_free() shrinks below this usage */
+
+/* Flags */
+#define MY_ARRAY_INIT_BUFFER_USED 1 /* buffer is the caller's, never freed */
+
+struct my_array_growth_t
+{
+  unsigned int policy;        /* MY_ARRAY_GROW_... */
+  unsigned int factor;        /* Percent, > 100 */
+  unsigned int increment;     /* Fixed step, minimum geometric step */
+  unsigned int max_increment; /* Maximum step of MY_ARRAY_GROW_CAPPED */
+};
+
+typedef struct my_array_growth_t my_array_growth;
+
 struct my_array_t
 {
-  unsigned void* buffer;  /**/
-  unsigned int elements;  /**/
-  unsigned int number;    /**/
-  unsigned int increment; /**/
-  unsigned int size;      /**/
+  unsigned char* buffer;  /* Elements */
+  unsigned int elements;  /* Elements in use */
+  unsigned int number;    /* Elements allocated */
+  unsigned int size;      /* Size of one element */
+  unsigned int flags;     /* MY_ARRAY_INIT_BUFFER_USED */
+  my_array_growth growth;
 };
 
 typedef struct my_array_t my_array;
 
-#define my_array_reset(array) ((array)->elements= 0
+/* Predicate of my_array_remove_if(), returns non zero to remove element */
+typedef int (*my_array_pred)(const void* element, void* arg);
+
+#define my_array_reset(array) ((array)->elements= 0)
 #define my_array_element(array, index, type) ((type)((array)->buffer) + (index))
 
 MY_GLOBAL_API my_array* my_array_init(void*__buffer, unsigned __number, 
@@ -43,18 +72,50 @@ MY_GLOBAL_API my_array* my_array_init(void*__buffer, unsigned __number,
 
 MY_GLOBAL_API void my_array_uninit(my_array* __array);
 
+MY_GLOBAL_API void my_array_set_growth(my_array* __array, unsigned int __policy,
+                                        unsigned int __factor, unsigned int __max_increment);
+
+MY_GLOBAL_API unsigned int my_array_grow(const my_array_growth* __growth, unsigned int __number,
+                                          unsigned int __wanted);
+
+MY_GLOBAL_API int my_array_reserve(my_array* __array, unsigned int __number);
+
 MY_GLOBAL_API void* my_array_alloc(my_array* __array);
 
-MY_GLOBAL_API void my_array_insert(my_array* __array);
+MY_GLOBAL_API int my_array_insert(my_array* __array, const void* __element);
+
+MY_GLOBAL_API int my_array_append(my_array* __array, const void* __elements, unsigned int __count);
+
+MY_GLOBAL_API int my_array_insert_range(my_array* __array, unsigned int __idx,
+                                         const void* __elements, unsigned int __count);
 
 MY_GLOBAL_API void* my_array_pop(my_array* __array);
 
 MY_GLOBAL_API void my_array_delete(my_array* __array, unsigned int __idx);
 
+MY_GLOBAL_API void my_array_erase(my_array* __array, unsigned int __idx, unsigned int __count);
+
+MY_GLOBAL_API unsigned int my_array_remove_if(my_array* __array, my_array_pred __pred, void* __arg);
+
 MY_GLOBAL_API int my_array_get(my_array* __array, void* __element, unsigned int __idx);
 
 MY_GLOBAL_API int my_array_set(my_array* __array, const void* __element, unsigned int __idx);
 
+MY_GLOBAL_API int my_array_sort(my_array* __array, qsort_cmp2 __cmp, const void* __arg,
+                                 unsigned int __threads);
+
+MY_GLOBAL_API int my_array_radix_sort(my_array* __array, size_t __offset, size_t __length,
+                                       unsigned int __flags);
+
+MY_GLOBAL_API unsigned int my_array_find(my_array* __array, unsigned int __offset, unsigned int __width,
+                                          unsigned int __op, unsigned long long __value);
+
+MY_GLOBAL_API unsigned int my_array_count(my_array* __array, unsigned int __offset, unsigned int __width,
+                                           unsigned int __op, unsigned long long __value);
+
+MY_GLOBAL_API int my_array_filter(my_array* __array, unsigned int __offset, unsigned int __width,
+                                   unsigned int __op, unsigned long long __value, my_array* __rows);
+
 MY_GLOBAL_API void my_array_free(my_array* __array);	
 								
 C_MODE_END
@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Typed C++ front end of my_array. Header only, the element size is
+ * known at compile time and elements are moved, not copied bytewise.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_ARRAY_HPP
+#define __MY_ARRAY_HPP
+
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_array.h"
+
+namespace my_libs {
+
+/*
+  Growable array of T
+
+  The buffer comes from my_malloc_ex() accounted to MY_MEM_ARRAY and grows
+  with my_array_grow(), so the growth policies of the C array apply.
+  Like the C API, operations that allocate report failure instead of
+  throwing: push_back() and friends return non zero (TRUE) and
+  emplace_back() returns NULL when memory is exhausted.
+
+  Trivially copyable types are grown with my_realloc_ex() and copied with
+  memcpy; other types are move constructed into the new buffer. As with
+  std::vector, the value added may be an element of the array itself:
+  it is read before the old buffer is released.
+  Only arrays of trivially copyable types convert to and from the C
+  ::my_array.
+*/
+
+template <typename T>
+class my_array
+{
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef unsigned int size_type;
+
+    my_array() : m_buffer(NULL), m_elements(0), m_number(0)
+    {
+        m_growth.policy = MY_ARRAY_GROW_GEOMETRIC;
+        m_growth.factor = MY_ARRAY_GROW_FACTOR;
+        m_growth.increment = ARRAY_INIT_INCREMENT;
+        m_growth.max_increment = 0;
+    }
+
+    explicit my_array(const my_array_growth& growth)
+        : m_buffer(NULL), m_elements(0), m_number(0), m_growth(growth)
+    {
+    }
+
+    /* Copy the elements of a C array, which must hold elements of size sizeof(T) */
+    explicit my_array(const ::my_array* array)
+        : m_buffer(NULL), m_elements(0), m_number(0), m_growth(array->growth)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "only trivially copyable types share the C layout");
+        if (array->size == sizeof(T) && !reserve(array->elements))
+        {
+            memcpy(m_buffer, array->buffer, (size_t) array->elements * sizeof(T));
+            m_elements = array->elements;
+        }
+    }
+
+    /* Out of memory leaves the copy empty, see assign() */
+    my_array(const my_array& other)
+        : m_buffer(NULL), m_elements(0), m_number(0), m_growth(other.m_growth)
+    {
+        append(other.begin(), other.size());
+    }
+
+    my_array(my_array&& other) noexcept
+        : m_buffer(other.m_buffer), m_elements(other.m_elements),
+          m_number(other.m_number), m_growth(other.m_growth)
+    {
+        other.m_buffer = NULL;
+        other.m_elements = other.m_number = 0;
+    }
+
+    ~my_array()
+    {
+        clear();
+        my_free(m_buffer);
+    }
+
+    /* Out of memory leaves the array empty, see assign() */
+    my_array& operator=(const my_array& other)
+    {
+        assign(other);
+        return *this;
+    }
+
+    my_array& operator=(my_array&& other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            my_free(m_buffer);
+            m_buffer = other.m_buffer;
+            m_elements = other.m_elements;
+            m_number = other.m_number;
+            m_growth = other.m_growth;
+            other.m_buffer = NULL;
+            other.m_elements = other.m_number = 0;
+        }
+        return *this;
+    }
+
+    size_type size() const { return m_elements; }
+    size_type capacity() const { return m_number; }
+    bool empty() const { return m_elements == 0; }
+    T* data() { return m_buffer; }
+    const T* data() const { return m_buffer; }
+    iterator begin() { return m_buffer; }
+    iterator end() { return m_buffer + m_elements; }
+    const_iterator begin() const { return m_buffer; }
+    const_iterator end() const { return m_buffer + m_elements; }
+    T& operator[](size_type idx) { return m_buffer[idx]; }
+    const T& operator[](size_type idx) const { return m_buffer[idx]; }
+    T& back() { return m_buffer[m_elements - 1]; }
+    const T& back() const { return m_buffer[m_elements - 1]; }
+
+    void set_growth(unsigned int policy, unsigned int factor, unsigned int max_increment)
+    {
+        m_growth.policy = policy;
+        m_growth.factor = factor > 100 ? factor : MY_ARRAY_GROW_FACTOR;
+        m_growth.max_increment = max_increment;
+    }
+
+    /*
+      Make room for number elements, like my_array_reserve()
+
+      RETURN
+        0   ok
+        1   Out of memory, the array is unchanged
+    */
+    int reserve(size_type number)
+    {
+        return number <= m_number ? 0 : resize_buffer(number);
+    }
+
+    /*
+      Replace the elements and growth policy by those of other
+
+      RETURN
+        0   ok
+        1   Out of memory, the array is empty
+    */
+    int assign(const my_array& other)
+    {
+        if (this == &other)
+            return 0;
+        clear();
+        m_growth = other.m_growth;
+        return append(other.begin(), other.size());
+    }
+
+    template <typename... Args>
+    T* emplace_back(Args&&... args)
+    {
+        T* element;
+
+        if (m_elements < m_number)
+            element = new (m_buffer + m_elements) T(std::forward<Args>(args)...);
+        else if (!(element = emplace_grow(trivial(), std::forward<Args>(args)...)))
+            return NULL;
+        m_elements++;
+        return element;
+    }
+
+    int push_back(const T& value) { return emplace_back(value) == NULL; }
+    int push_back(T&& value) { return emplace_back(std::move(value)) == NULL; }
+
+    /*
+      Copy count elements at the end, with one growth. elements may be in
+      the array: when it grows they are copied into the new buffer before
+      the old one is freed.
+    */
+    int append(const T* elements, size_type count)
+    {
+        T* buffer;
+        size_type number;
+
+        if (count > (size_type) -1 - m_elements)
+            return 1;
+        if (m_elements + count <= m_number)
+            copy_construct(m_buffer + m_elements, elements, count);
+        else
+        {
+            number = ::my_array_grow(&m_growth, m_number, m_elements + count);
+            if (!(buffer = allocate(number)))
+                return 1;
+            try
+            {
+                copy_construct(buffer + m_elements, elements, count);
+            }
+            catch (...)
+            {
+                my_free(buffer);
+                throw;
+            }
+            relocate(buffer, number, count);
+        }
+        m_elements += count;
+        return 0;
+    }
+
+    void pop_back()
+    {
+        m_buffer[--m_elements].~T();
+    }
+
+    /* Delete count elements starting at idx, like my_array_erase() */
+    void erase(size_type idx, size_type count = 1)
+    {
+        size_type i;
+
+        if (idx >= m_elements)
+            return;
+        if (count > m_elements - idx)
+            count = m_elements - idx;
+        if (std::is_trivially_copyable<T>::value)
+            memmove((void*) (m_buffer + idx), m_buffer + idx + count,
+                    (size_t) (m_elements - idx - count) * sizeof(T));
+        else
+        {
+            for (i = idx; i + count < m_elements; i++)
+                m_buffer[i] = std::move(m_buffer[i + count]);
+            for (; i < m_elements; i++)
+                m_buffer[i].~T();
+        }
+        m_elements -= count;
+    }
+
+    /* Delete the elements pred() is true for, in one pass */
+    template <typename Pred>
+    size_type remove_if(Pred pred)
+    {
+        size_type idx, to = 0;
+
+        for (idx = 0; idx < m_elements; idx++)
+        {
+            if (pred(m_buffer[idx]))
+                continue;
+            if (to != idx)
+                m_buffer[to] = std::move(m_buffer[idx]);
+            to++;
+        }
+        idx = m_elements - to;
+        while (m_elements > to)
+            m_buffer[--m_elements].~T();
+        return idx;
+    }
+
+    void clear()
+    {
+        while (m_elements)
+            m_buffer[--m_elements].~T();
+    }
+
+    /* Free unused memory with the hysteresis of my_array_free() */
+    void shrink()
+    {
+        size_type elements = m_elements ? m_elements : 1;
+
+        if (m_buffer && (unsigned long long) elements * 100 <
+            (unsigned long long) m_number * MY_ARRAY_SHRINK_PERCENT)
+            resize_buffer(elements);
+    }
+
+    /*
+      Copy the elements into a new C array
+
+      RETURN
+        pointer  Free it with my_array_uninit() and my_free()
+        NULL     Out of memory
+    */
+    ::my_array* to_c() const
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "only trivially copyable types share the C layout");
+        ::my_array* array;
+
+        if (!(array = ::my_array_init(NULL, MAX(m_elements, 1), m_growth.increment, sizeof(T))))
+            return NULL;
+        array->growth = m_growth;
+        if (::my_array_append(array, m_buffer, m_elements))
+        {
+            ::my_array_uninit(array);
+            my_free(array);
+            return NULL;
+        }
+        return array;
+    }
+
+private:
+    typedef std::integral_constant<bool, std::is_trivially_copyable<T>::value> trivial;
+
+    /* Construct the element past the end of a full array, growing it */
+    template <typename... Args>
+    T* emplace_grow(std::true_type, Args&&... args)
+    {
+        /* args may refer to the buffer my_realloc_ex() frees */
+        T value(std::forward<Args>(args)...);
+
+        if (grow(m_elements + 1))
+            return NULL;
+        return new (m_buffer + m_elements) T(std::move(value));
+    }
+
+    template <typename... Args>
+    T* emplace_grow(std::false_type, Args&&... args)
+    {
+        T* buffer;
+        T* element;
+        size_type number = ::my_array_grow(&m_growth, m_number, m_elements + 1);
+
+        /* Build the element while args, maybe in the old buffer, are valid */
+        if (!(buffer = allocate(number)))
+            return NULL;
+        try
+        {
+            element = new (buffer + m_elements) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            my_free(buffer);
+            throw;
+        }
+        relocate(buffer, number, 1);
+        return element;
+    }
+
+    /* Copy count elements to raw memory, none is left built if a copy throws */
+    static void copy_construct(T* to, const T* from, size_type count)
+    {
+        size_type i = 0;
+
+        if (std::is_trivially_copyable<T>::value)
+            memcpy((void*) to, from, (size_t) count * sizeof(T));
+        else
+        {
+            try
+            {
+                for (; i < count; i++)
+                    new (to + i) T(from[i]);
+            }
+            catch (...)
+            {
+                destroy(to, i);
+                throw;
+            }
+        }
+    }
+
+    static void destroy(T* elements, size_type count)
+    {
+        while (count)
+            elements[--count].~T();
+    }
+
+    int grow(size_type wanted)
+    {
+        return wanted <= m_number ? 0 : resize_buffer(::my_array_grow(&m_growth, m_number, wanted));
+    }
+
+    static T* allocate(size_type number)
+    {
+        return (T*) my_malloc_ex((size_t) number * sizeof(T), MY_MEM_ARRAY);
+    }
+
+    /*
+      Move the elements into buffer of number elements and free the old
+      one. added elements are already built in buffer after them.
+
+      The old elements are destroyed only once all are in buffer: if a
+      copy throws, buffer and what was built in it are freed and the
+      array is unchanged. Elements are copied rather than moved when
+      their move may throw, as std::vector does.
+    */
+    void relocate(T* buffer, size_type number, size_type added = 0)
+    {
+        size_type i = 0;
+
+        if (std::is_trivially_copyable<T>::value)
+        {
+            if (m_elements)
+                memcpy((void*) buffer, m_buffer, (size_t) m_elements * sizeof(T));
+        }
+        else
+        {
+            try
+            {
+                for (; i < m_elements; i++)
+                    new (buffer + i) T(std::move_if_noexcept(m_buffer[i]));
+            }
+            catch (...)
+            {
+                destroy(buffer, i);
+                destroy(buffer + m_elements, added);
+                my_free(buffer);
+                throw;
+            }
+            destroy(m_buffer, m_elements);
+        }
+        my_free(m_buffer);
+        m_buffer = buffer;
+        m_number = number;
+    }
+
+    int resize_buffer(size_type number)
+    {
+        T* buffer;
+
+        if (std::is_trivially_copyable<T>::value)
+        {
+            if (!(buffer = (T*) my_realloc_ex(m_buffer, (size_t) number * sizeof(T), MY_MEM_ARRAY)))
+                return 1;
+            m_buffer = buffer;
+            m_number = number;
+        }
+        else
+        {
+            if (!(buffer = allocate(number)))
+                return 1;
+            relocate(buffer, number);
+        }
+        return 0;
+    }
+
+    T* m_buffer;
+    size_type m_elements;
+    size_type m_number;
+    my_array_growth m_growth;
+};
+
+}  // namespace my_libs
+
+#endif  //__MY_ARRAY_HPP
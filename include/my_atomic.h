@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Atomic operations on naturally aligned integers and pointers of 4 or
+ * 8 bytes.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_ATOMIC_H
+#define __MY_ATOMIC_H
+
+#include "my_global_exports.h"
+
+C_MODE_START
+
+/*
+  my_atomic_add()/load()/store() are relaxed: they are meant for
+  statistics and counters that do not order other memory accesses.
+  my_atomic_cas() is a full barrier, acquire/release variants are used
+  to publish data between threads.
+*/
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+/*
+  The Interlocked functions have one size each, the macros pick the one
+  of the object: 4 or 8 bytes, other sizes are not supported.
+*/
+
+static __inline int my_atomic_cas32(volatile LONG* p, LONG* e, LONG v)
+{
+    LONG old = InterlockedCompareExchange(p, v, *e);
+
+    if (old == *e)
+        return 1;
+    *e = old;
+    return 0;
+}
+
+static __inline int my_atomic_cas64(volatile LONG64* p, LONG64* e, LONG64 v)
+{
+    LONG64 old = InterlockedCompareExchange64(p, v, *e);
+
+    if (old == *e)
+        return 1;
+    *e = old;
+    return 0;
+}
+
+#define my_atomic_add(P, V)             \
+    (sizeof(*(P)) == 8 ? InterlockedExchangeAdd64((volatile LONG64*) (P), (LONG64) (V)) : \
+     (LONG64) InterlockedExchangeAdd((volatile LONG*) (P), (LONG) (V)))
+#define my_atomic_load(P)               \
+    (sizeof(*(P)) == 8 ? *(volatile LONG64*) (P) : (LONG64) *(volatile LONG*) (P))
+#define my_atomic_store(P, V)           \
+    (sizeof(*(P)) == 8 ? (void) (*(volatile LONG64*) (P) = (LONG64) (V)) : \
+     (void) (*(volatile LONG*) (P) = (LONG) (V)))
+#define my_atomic_load_acquire(P)       my_atomic_load(P)
+#define my_atomic_store_release(P, V)   my_atomic_store(P, V)
+#define my_atomic_cas(P, E, V)          \
+    (sizeof(*(P)) == 8 ? my_atomic_cas64((volatile LONG64*) (P), (LONG64*) (E), (LONG64) (V)) : \
+     my_atomic_cas32((volatile LONG*) (P), (LONG*) (E), (LONG) (V)))
+
+#else
+
+#define my_atomic_add(P, V)             __atomic_fetch_add((P), (V), __ATOMIC_RELAXED)
+#define my_atomic_load(P)               __atomic_load_n((P), __ATOMIC_RELAXED)
+#define my_atomic_store(P, V)           __atomic_store_n((P), (V), __ATOMIC_RELAXED)
+#define my_atomic_load_acquire(P)       __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define my_atomic_store_release(P, V)   __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#define my_atomic_cas(P, E, V)          \
+    __atomic_compare_exchange_n((P), (E), (V), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+#endif /* _WIN32 */
+
+C_MODE_END
+
+#endif  //__MY_ATOMIC_H
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Bit manipulation helpers.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_BIT_H
+#define __MY_BIT_H
+
+#include "my_global_exports.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+C_MODE_START
+
+/*
+  Position of the highest bit set, value must not be 0.
+  my_bit_log2(1) == 0, my_bit_log2(4096) == 12.
+*/
+
+static inline unsigned int my_bit_log2(unsigned int value)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse(&idx, value);
+    return (unsigned int) idx;
+#else
+    return (unsigned int) (sizeof(unsigned int) * 8 - 1 - __builtin_clz(value));
+#endif
+}
+
+
+static inline unsigned int my_bit_log2_64(unsigned long long value)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, value);
+    return (unsigned int) idx;
+#else
+    return (unsigned int) (sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(value));
+#endif
+}
+
+
+/* Position of the lowest bit set, value must not be 0 */
+
+static inline unsigned int my_bit_ctz_64(unsigned long long value)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, value);
+    return (unsigned int) idx;
+#else
+    return (unsigned int) __builtin_ctzll(value);
+#endif
+}
+
+
+static inline unsigned int my_bit_count_64(unsigned long long value)
+{
+#if defined(_MSC_VER)
+    return (unsigned int) __popcnt64(value);
+#else
+    return (unsigned int) __builtin_popcountll(value);
+#endif
+}
+
+
+/* Smallest power of two not below value, value must be in 1..2^31 */
+
+static inline unsigned int my_round_up_to_next_power(unsigned int value)
+{
+    return value <= 1 ? 1 : 2U << my_bit_log2(value - 1);
+}
+
+C_MODE_END
+
+#endif  //__MY_BIT_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Columnar array. Records are split into their fields and every field
+ * is stored in its own contiguous column, so a scan of one field only
+ * reads that field.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_COL_ARRAY_H
+#define __MY_COL_ARRAY_H
+
+#include "my_global_exports.h"
+#include "my_array.h"
+
+C_MODE_START
+
+/* Columns are aligned for vector loads */
+#define MY_COL_ARRAY_ALIGN  64
+
+/* A field of the record, offset and size in the record layout */
+struct my_col_field_t
+{
+  unsigned int offset;
+  unsigned int size;
+};
+
+typedef struct my_col_field_t my_col_field;
+
+struct my_col_array_t
+{
+  unsigned char** columns;  /* One buffer per field */
+  my_col_field* fields;     /* Schema, copied */
+  unsigned int field_count;
+  unsigned int elements;    /* Rows in use */
+  unsigned int number;      /* Rows allocated in every column */
+  unsigned int record_size; /* Size of the record layout */
+  my_array_growth growth;
+};
+
+typedef struct my_col_array_t my_col_array;
+
+#define my_col_array_reset(array) ((array)->elements= 0)
+
+/* Start of the column of a field, rows are (array)->fields[field].size apart */
+#define my_col_array_column(array, field) ((void*) (array)->columns[field])
+
+/* Value of field in a row */
+#define my_col_array_value(array, field, row, type) \
+    ((type)((array)->columns[field]) + (row))
+
+MY_GLOBAL_API my_col_array* my_col_array_init(const my_col_field* __fields, unsigned int __field_count,
+                                              unsigned int __record_size, unsigned int __number);
+
+MY_GLOBAL_API void my_col_array_uninit(my_col_array* __array);
+
+MY_GLOBAL_API int my_col_array_reserve(my_col_array* __array, unsigned int __number);
+
+MY_GLOBAL_API int my_col_array_append(my_col_array* __array, const void* __records, unsigned int __count);
+
+MY_GLOBAL_API int my_col_array_get(my_col_array* __array, void* __record, unsigned int __idx);
+
+MY_GLOBAL_API int my_col_array_set(my_col_array* __array, const void* __record, unsigned int __idx);
+
+MY_GLOBAL_API void my_col_array_gather(my_col_array* __array, unsigned int __field,
+                                       const unsigned int* __rows, unsigned int __count, void* __to);
+
+MY_GLOBAL_API int my_col_array_free(my_col_array* __array);
+
+C_MODE_END
+
+#endif //__MY_COL_ARRAY_H
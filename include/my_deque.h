@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Double ended queue. A ring buffer of fixed size elements with constant
+ * time insertion and removal at both ends.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_DEQUE_H
+#define __MY_DEQUE_H
+
+#include "my_global_exports.h"
+#include "my_array.h"
+
+C_MODE_START
+
+/*
+  Element i of the deque is at slot (head + i) modulo number. The used
+  slots wrap around the end of the buffer at most once, so the elements
+  are at most two contiguous spans.
+*/
+
+struct my_deque_t
+{
+  unsigned char* buffer;
+  unsigned int head;        /* Slot of the first element */
+  unsigned int elements;    /* Elements in use */
+  unsigned int number;      /* Slots allocated */
+  unsigned int size;        /* Size of one element */
+  my_array_growth growth;
+};
+
+typedef struct my_deque_t my_deque;
+
+#define my_deque_elements(deque) ((deque)->elements)
+#define my_deque_reset(deque) ((deque)->head= (deque)->elements= 0)
+
+/* Slot of element idx, idx must be below number */
+
+static inline unsigned int my_deque_slot(const my_deque* __deque, unsigned int __idx)
+{
+    unsigned int slot = __deque->head + __idx;
+
+    return slot >= __deque->number || slot < __idx ? slot - __deque->number : slot;
+}
+
+/* Address of element idx, which must be below elements */
+
+static inline void* my_deque_element(const my_deque* __deque, unsigned int __idx)
+{
+    return __deque->buffer + (size_t) my_deque_slot(__deque, __idx) * __deque->size;
+}
+
+MY_GLOBAL_API my_deque* my_deque_init(unsigned int __number, unsigned int __increment, unsigned int __size);
+
+MY_GLOBAL_API void my_deque_uninit(my_deque* __deque);
+
+MY_GLOBAL_API void my_deque_set_growth(my_deque* __deque, unsigned int __policy,
+                                       unsigned int __factor, unsigned int __max_increment);
+
+MY_GLOBAL_API int my_deque_reserve(my_deque* __deque, unsigned int __number);
+
+MY_GLOBAL_API int my_deque_push_back(my_deque* __deque, const void* __element);
+
+MY_GLOBAL_API int my_deque_push_front(my_deque* __deque, const void* __element);
+
+MY_GLOBAL_API void* my_deque_pop_front(my_deque* __deque);
+
+MY_GLOBAL_API void* my_deque_pop_back(my_deque* __deque);
+
+MY_GLOBAL_API void* my_deque_front(my_deque* __deque);
+
+MY_GLOBAL_API void* my_deque_back(my_deque* __deque);
+
+MY_GLOBAL_API int my_deque_get(my_deque* __deque, void* __element, unsigned int __idx);
+
+MY_GLOBAL_API int my_deque_set(my_deque* __deque, const void* __element, unsigned int __idx);
+
+MY_GLOBAL_API int my_deque_push_back_many(my_deque* __deque, const void* __elements, unsigned int __count);
+
+MY_GLOBAL_API unsigned int my_deque_pop_front_many(my_deque* __deque, void* __to, unsigned int __count);
+
+MY_GLOBAL_API void* my_deque_front_span(my_deque* __deque, unsigned int* __count);
+
+MY_GLOBAL_API void my_deque_consume_front(my_deque* __deque, unsigned int __count);
+
+MY_GLOBAL_API void* my_deque_back_span(my_deque* __deque, unsigned int __wanted, unsigned int* __count);
+
+MY_GLOBAL_API void my_deque_commit_back(my_deque* __deque, unsigned int __count);
+
+C_MODE_END
+
+#endif //__MY_DEQUE_H
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * External merge sort. Sorts fixed size records within a memory budget,
+ * spilling sorted runs to a temporary file and merging them.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_EXTSORT_H
+#define __MY_EXTSORT_H
+
+#include <stddef.h>
+#include "my_global_exports.h"
+#include "my_array.h"
+#include "my_merge.h"
+#include "my_qsort.h"
+
+C_MODE_START
+
+#define MY_EXTSORT_BUDGET       (64 * 1024 * 1024)  /* Default memory budget */
+#define MY_EXTSORT_MIN_BUFFER   (64 * 1024)         /* Smallest read buffer of a run */
+
+struct my_extsort_run_t
+{
+  unsigned long long offset;    /* In the temporary file */
+  unsigned long long count;     /* Records */
+};
+
+typedef struct my_extsort_run_t my_extsort_run;
+
+struct my_extsort_t
+{
+  size_t size;                  /* Size of one record */
+  qsort_cmp2 cmp;
+  const void* cmp_arg;
+  size_t budget;                /* Bytes of memory to use */
+  unsigned int threads;         /* Threads sorting a run */
+  char* tmpdir;                 /* Directory of the temporary file, NULL for the default */
+  unsigned char* buffer;        /* Records not yet in a run */
+  size_t capacity;              /* Records buffer holds */
+  size_t count;                 /* Records in buffer */
+  int fd;                       /* Temporary file, -1 until the first run is written */
+  unsigned long long file_size;
+  my_array* runs;               /* my_extsort_run, in the temporary file */
+  my_merge* merge;              /* Output, once finished */
+  unsigned long long records;   /* Records added */
+  bool finished;
+  int error;
+};
+
+typedef struct my_extsort_t my_extsort;
+
+#define my_extsort_error(sort) ((sort)->error)
+#define my_extsort_records(sort) ((sort)->records)
+
+MY_GLOBAL_API my_extsort* my_extsort_init(size_t __size, qsort_cmp2 __cmp, const void* __arg,
+                                          size_t __budget, unsigned int __threads, const char* __tmpdir);
+
+MY_GLOBAL_API void my_extsort_uninit(my_extsort* __sort);
+
+MY_GLOBAL_API int my_extsort_add(my_extsort* __sort, const void* __records, size_t __count);
+
+MY_GLOBAL_API int my_extsort_finish(my_extsort* __sort);
+
+MY_GLOBAL_API const void* my_extsort_next(my_extsort* __sort);
+
+MY_GLOBAL_API size_t my_extsort_next_batch(my_extsort* __sort, void* __to, size_t __count);
+
+MY_GLOBAL_API int my_extsort_file(const char* __from, const char* __to, size_t __size, qsort_cmp2 __cmp,
+                                  const void* __arg, size_t __budget, unsigned int __threads,
+                                  const char* __tmpdir);
+
+C_MODE_END
+
+#endif //__MY_EXTSORT_H
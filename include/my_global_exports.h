@@ -40,8 +40,8 @@
 #endif
 
 /* Define boolean logical constants */
-#ifndef HAS_BOOLEAN 
-typedef char bool
+#if !defined(HAS_BOOLEAN) && !defined(__cplusplus)
+typedef char bool;
 #endif
 
 #ifndef TRUE
@@ -54,4 +54,13 @@ typedef char bool
 
 #define MY_ALIGN(A, L)	(((A) + (L) - 1) & ~((L) - 1))
 
+/* Size of a cache line, structures written by different threads are padded to it */
+#define MY_CACHE_LINE_SIZE	64
+
+#if defined(_MSC_VER)
+#define MY_ALIGNED(N)	__declspec(align(N))
+#else
+#define MY_ALIGNED(N)	__attribute__((aligned(N)))
+#endif
+
 #endif  //__MY_GLOBAL_EXPORTS_H
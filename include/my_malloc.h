@@ -1,6 +1,6 @@
 /*
  * Copyright (c) 2013, Heng Wang personal. All rights reserved.
- * 
+ *
  * Global exports header file.
  *
  * @Author:  Heng.Wang
@@ -10,19 +10,95 @@
  * @Github:  https://github.com/HengWang/
  * @Blog  :  http://hengwang.blog.chinaunix.net
  * */
- 
+
 #ifndef __MY_MALLOC_H
 #define __MY_MALLOC_H
 
+#include <stddef.h>
 #include "my_global_exports.h"
 
 C_MODE_START
 
-MY_GLOBAL_API void *my_malloc(size_t __length);  
-MY_GLOBAL_API void *my_calloc(size_t __length, size_t __value);  
-MY_GLOBAL_API void *my_realloc(void* __data, size_t __length); 
+/* Flags for my_malloc_init() */
+#define MY_MALLOC_SYSTEM    0   /* All requests go to malloc()/free() */
+#define MY_MALLOC_SLAB      1   /* Small requests come from per-thread slab caches */
+#define MY_MALLOC_STATS     2   /* Keep allocation statistics */
+#define MY_MALLOC_HUGEPAGES 4   /* Ask for transparent huge pages on mapped blocks */
+
+#define MY_SLAB_MAX_SIZE    2048        /* Biggest block (with header) served by the slabs */
+#define MY_SLAB_MAGAZINE    64          /* Blocks moved between thread cache and depot at once */
+#define MY_SLAB_CHUNK_SIZE  (64*1024)   /* Memory carved into blocks at a time */
+
+#define MY_MMAP_THRESHOLD   (32*1024*1024) /* Default size from which blocks are mmap()ed */
+
+#define MY_MALLOC_SHARDS    64          /* Statistics shards, threads are spread over them */
+#define MY_MALLOC_HISTOGRAM 32          /* Size histogram buckets, bucket i counts sizes < 2^i */
+#define MY_MALLOC_STATS_BATCH (256*1024) /* Live bytes a thread accumulates before publishing */
+
+/*
+  Tags attribute allocations to a subsystem. Tags from MY_MEM_USER up to
+  MY_MEM_TAGS - 1 are free for the application.
+*/
+enum my_memory_tag {
+    MY_MEM_UNKNOWN = 0,
+    MY_MEM_ARRAY,
+    MY_MEM_HASH,
+    MY_MEM_RBTREE,
+    MY_MEM_QUEUE,
+    MY_MEM_LIST,
+    MY_MEM_ALLOC_ROOT,
+    MY_MEM_USER,
+    MY_MEM_TAGS = 32
+};
+
+typedef struct my_malloc_tag_stats_t
+{
+    unsigned long long allocations;     /* Successful allocations */
+    unsigned long long frees;           /* Blocks freed */
+    unsigned long long bytes_live;      /* Requested bytes not yet freed */
+} my_malloc_tag_stats;
+
+typedef struct my_malloc_stats_t
+{
+    unsigned long long allocations;
+    unsigned long long frees;
+    unsigned long long bytes_allocated; /* Requested bytes, reallocs included */
+    unsigned long long bytes_freed;
+    unsigned long long bytes_live;
+    unsigned long long bytes_peak;      /* Highest bytes_live, see my_malloc_stats_snapshot() */
+    unsigned long long histogram[MY_MALLOC_HISTOGRAM];
+    my_malloc_tag_stats tags[MY_MEM_TAGS];
+    unsigned long long bytes_moved;     /* Bytes copied because a block moved */
+    unsigned long long bytes_remapped;  /* Bytes kept by mremap() without copying */
+    unsigned long long mmap_allocations;
+} my_malloc_stats;
+
+typedef void (*malloc_handler_t)();
+
+MY_GLOBAL_API int my_malloc_init(unsigned int __flags);
+MY_GLOBAL_API void my_malloc_end(void);
+MY_GLOBAL_API malloc_handler_t malloc_set_handler(malloc_handler_t __handler);
+
+MY_GLOBAL_API void *my_malloc(size_t __length);
+MY_GLOBAL_API void *my_calloc(size_t __length, size_t __value);
+MY_GLOBAL_API void *my_realloc(void* __data, size_t __length);
 MY_GLOBAL_API void *my_free(void* __data);
 
+MY_GLOBAL_API void *my_malloc_ex(size_t __length, unsigned int __tag);
+MY_GLOBAL_API void *my_calloc_ex(size_t __length, size_t __value, unsigned int __tag);
+MY_GLOBAL_API void *my_realloc_ex(void* __data, size_t __length, unsigned int __tag);
+
+MY_GLOBAL_API void *my_malloc_aligned(size_t __length, size_t __alignment);
+MY_GLOBAL_API void *my_malloc_aligned_ex(size_t __length, size_t __alignment, unsigned int __tag);
+MY_GLOBAL_API void *my_malloc_padded(size_t __length);
+MY_GLOBAL_API void *my_malloc_padded_ex(size_t __length, unsigned int __tag);
+MY_GLOBAL_API void *my_free_aligned(void* __data);
+
+MY_GLOBAL_API size_t my_malloc_size(const void* __data);
+MY_GLOBAL_API size_t my_malloc_trim(void* __data, size_t __used);
+MY_GLOBAL_API size_t my_malloc_set_mmap_threshold(size_t __threshold);
+MY_GLOBAL_API void my_malloc_stats_snapshot(my_malloc_stats* __stats);
+
 C_MODE_END
 
 #endif  //__MY_MALLOC_H
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * File backed array. The elements live in a memory mapped file, so an
+ * array built once is opened again by mapping it instead of rebuilding it.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_MAP_ARRAY_H
+#define __MY_MAP_ARRAY_H
+
+#include <stddef.h>
+#include "my_global_exports.h"
+#include "my_array.h"
+
+C_MODE_START
+
+#define MY_MAP_ARRAY_MAGIC          0x5241594DU /* "MYAR" */
+#define MY_MAP_ARRAY_VERSION        1
+#define MY_MAP_ARRAY_HEADER_SIZE    64          /* Elements start here, aligned */
+
+/* Flags of my_map_array_open() */
+#define MY_MAP_ARRAY_CREATE     1   /* Create the file if it does not exist */
+#define MY_MAP_ARRAY_TRUNCATE   2   /* Start with an empty array */
+#define MY_MAP_ARRAY_READ_ONLY  4   /* Map read only, modifications fail */
+
+/* On disk header, in host byte order */
+struct my_map_array_header_t
+{
+  unsigned int magic;               /* MY_MAP_ARRAY_MAGIC */
+  unsigned int version;             /* MY_MAP_ARRAY_VERSION */
+  unsigned int size;                /* Size of one element */
+  unsigned int user_version;        /* Free for the owner of the file */
+  unsigned long long elements;      /* Elements in use */
+  unsigned long long number;        /* Elements the file has room for */
+};
+
+typedef struct my_map_array_header_t my_map_array_header;
+
+struct my_map_array_t
+{
+  int fd;
+  unsigned int flags;
+  unsigned char* map;               /* Header followed by the elements */
+  size_t map_length;
+  my_map_array_header* header;      /* At map */
+  unsigned char* buffer;            /* First element */
+  unsigned int size;
+  my_array_growth growth;
+};
+
+typedef struct my_map_array_t my_map_array;
+
+#define my_map_array_elements(array) ((unsigned int) (array)->header->elements)
+#define my_map_array_reset(array) ((array)->header->elements= 0)
+#define my_map_array_element(array, index, type) ((type)((array)->buffer) + (index))
+
+MY_GLOBAL_API my_map_array* my_map_array_open(const char* __path, unsigned int __size, unsigned int __flags);
+
+MY_GLOBAL_API int my_map_array_close(my_map_array* __array);
+
+MY_GLOBAL_API int my_map_array_reserve(my_map_array* __array, unsigned int __number);
+
+MY_GLOBAL_API void* my_map_array_alloc(my_map_array* __array);
+
+MY_GLOBAL_API int my_map_array_insert(my_map_array* __array, const void* __element);
+
+MY_GLOBAL_API int my_map_array_append(my_map_array* __array, const void* __elements, unsigned int __count);
+
+MY_GLOBAL_API void* my_map_array_pop(my_map_array* __array);
+
+MY_GLOBAL_API int my_map_array_sync(my_map_array* __array, bool __wait);
+
+MY_GLOBAL_API int my_map_array_refresh(my_map_array* __array);
+
+MY_GLOBAL_API void my_map_array_view(my_map_array* __array, my_array* __view);
+
+C_MODE_END
+
+#endif //__MY_MAP_ARRAY_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Memory budgets. A pool counts the bytes charged to it against a soft
+ * and a hard limit and calls back its owner when memory gets tight.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_MEM_POOL_H
+#define __MY_MEM_POOL_H
+
+#include <stddef.h>
+#include "my_global_exports.h"
+
+C_MODE_START
+
+/* Levels passed to the pressure callback */
+#define MY_MEM_PRESSURE_SOFT    1   /* Soft limit crossed, please shed caches */
+#define MY_MEM_PRESSURE_HARD    2   /* A reservation would exceed the hard limit */
+#define MY_MEM_PRESSURE_OOM     3   /* The system allocator failed */
+
+typedef struct my_mem_pool_t my_mem_pool;
+
+/*
+  Called with the level and the number of bytes the caller is waiting for.
+  Returns the number of bytes it gave back (0 if it could not help).
+  The callback may release memory of its own pool but must not reserve.
+  It may allocate, also when called on a failed allocation.
+*/
+typedef size_t (*my_mem_pool_pressure)(my_mem_pool* pool, int level, size_t wanted, void* arg);
+
+struct my_mem_pool_t
+{
+    const char* name;
+    long long used;                 /* Bytes charged to the pool */
+    long long peak;                 /* Highest value of used */
+    size_t soft_limit;              /* 0 means no soft limit */
+    size_t hard_limit;              /* 0 means no hard limit */
+    my_mem_pool_pressure pressure;
+    void* pressure_arg;
+    int in_pressure;                /* Callback running, do not recurse */
+    int soft_signaled;              /* Soft callback done, rearmed below soft_limit */
+    unsigned long long failed;      /* Reservations refused */
+    unsigned int shedding;          /* my_mem_pool_shed() calls in the callback, under the list lock */
+    struct my_mem_pool_t* next;     /* All registered pools */
+};
+
+MY_GLOBAL_API void my_mem_pool_init(my_mem_pool* pool, const char* name, size_t soft_limit, size_t hard_limit);
+MY_GLOBAL_API void my_mem_pool_uninit(my_mem_pool* pool);
+MY_GLOBAL_API void my_mem_pool_set_pressure(my_mem_pool* pool, my_mem_pool_pressure pressure, void* arg);
+MY_GLOBAL_API void my_mem_pool_set_limits(my_mem_pool* pool, size_t soft_limit, size_t hard_limit);
+MY_GLOBAL_API int my_mem_pool_reserve(my_mem_pool* pool, size_t size);
+MY_GLOBAL_API void my_mem_pool_release(my_mem_pool* pool, size_t size);
+MY_GLOBAL_API void* my_mem_pool_malloc(my_mem_pool* pool, size_t size, unsigned int tag);
+MY_GLOBAL_API void my_mem_pool_free(my_mem_pool* pool, void* data);
+MY_GLOBAL_API size_t my_mem_pool_shed(int level, size_t wanted);
+
+#define my_mem_pool_used(pool) ((size_t) (pool)->used)
+
+C_MODE_END
+
+#endif  //__MY_MEM_POOL_H
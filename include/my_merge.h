@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * K-way merge. Merges sorted runs of fixed size records, from memory,
+ * files or a read function, into one sorted stream.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_MERGE_H
+#define __MY_MERGE_H
+
+#include <stddef.h>
+#include "my_global_exports.h"
+#include "my_qsort.h"
+#include "my_queue.h"
+
+C_MODE_START
+
+#define MY_MERGE_BUFFER_SIZE    (256 * 1024)    /* Default read buffer of a file run */
+#define MY_MERGE_READ_ERROR     ((size_t) -1)
+
+/*
+  Read up to count records of a run into buffer
+
+  RETURN
+    Records read, 0 at the end of the run, MY_MERGE_READ_ERROR on error
+*/
+typedef size_t (*my_merge_read_func)(void* arg, void* buffer, size_t count);
+
+/* One input run */
+
+struct my_merge_cursor_t
+{
+  unsigned char* buffer;        /* Records read and not merged yet */
+  size_t count;                 /* Records in buffer */
+  size_t pos;                   /* Next record in buffer */
+  size_t capacity;              /* Records the buffer holds, 0 if the run is all in buffer */
+  unsigned int idx;             /* Run number, orders equal records */
+  int fd;                       /* File run, -1 if not */
+  unsigned long long offset;    /* File offset of the next read */
+  unsigned long long remaining; /* Records left to read */
+  my_merge_read_func read;      /* Read function run, NULL if not */
+  void* read_arg;
+};
+
+typedef struct my_merge_cursor_t my_merge_cursor;
+
+struct my_merge_t
+{
+  my_queue queue;               /* Cursors not exhausted, lowest record on top */
+  my_merge_cursor* cursors;
+  unsigned int runs;            /* Cursors added */
+  unsigned int max_runs;
+  size_t size;                  /* Size of one record */
+  qsort_cmp2 cmp;
+  const void* cmp_arg;
+  my_merge_cursor* last;        /* Cursor of the record returned by my_merge_next() */
+  bool started;
+  int error;
+};
+
+typedef struct my_merge_t my_merge;
+
+#define my_merge_error(merge) ((merge)->error)
+
+MY_GLOBAL_API my_merge* my_merge_init(size_t __size, qsort_cmp2 __cmp, const void* __arg, unsigned int __max_runs);
+
+MY_GLOBAL_API void my_merge_uninit(my_merge* __merge);
+
+MY_GLOBAL_API int my_merge_add_memory(my_merge* __merge, const void* __base, size_t __count);
+
+MY_GLOBAL_API int my_merge_add_file(my_merge* __merge, int __fd, unsigned long long __offset,
+                                    unsigned long long __count, size_t __buffer_size);
+
+MY_GLOBAL_API int my_merge_add_reader(my_merge* __merge, my_merge_read_func __read, void* __arg,
+                                      size_t __buffer_size);
+
+MY_GLOBAL_API const void* my_merge_next(my_merge* __merge);
+
+MY_GLOBAL_API size_t my_merge_next_batch(my_merge* __merge, void* __to, size_t __count);
+
+C_MODE_END
+
+#endif //__MY_MERGE_H
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Concurrent relaxed priority queue (MultiQueue). Several my_queue heaps,
+ * each behind its own try-lock, shared by many threads.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_MULTI_QUEUE_H
+#define __MY_MULTI_QUEUE_H
+
+#include "my_global_exports.h"
+#include "my_queue.h"
+
+C_MODE_START
+
+#define MY_MULTI_QUEUE_FACTOR   2   /* Heaps per thread */
+#define MY_MULTI_QUEUE_TRIES    8   /* Random picks before my_multi_queue_pop() scans all heaps */
+
+/*
+  One heap, alone on its cache lines so that threads working on
+  different heaps do not share lines.
+*/
+
+typedef struct MY_ALIGNED(MY_CACHE_LINE_SIZE) my_multi_queue_heap_t {
+    my_queue queue;
+    long long lock;         /* 1 while a thread works on queue */
+    long long elements;     /* Copy of queue.elements, read without the lock */
+} my_multi_queue_heap;
+
+/*
+  An insert goes to a random heap. A pop locks two random heaps and
+  takes the better of their tops, so the element returned is close to,
+  but not always, the best one in the queue. Each thread draws from its
+  own random generator.
+*/
+
+struct my_multi_queue_t
+{
+  my_multi_queue_heap* heaps;
+  unsigned int count;           /* Heaps */
+  unsigned int offset_to_key;
+  int max_at_top;               /* 1, or -1 if the biggest elements come first */
+  queue_compare compare;
+  void* first_cmp_arg;
+};
+
+typedef struct my_multi_queue_t my_multi_queue;
+
+MY_GLOBAL_API int my_multi_queue_init(my_multi_queue* __queue, unsigned int __threads, unsigned int __max_elements,
+                                      unsigned int __offset_to_key, bool __max_at_top, queue_compare __compare,
+                                      void* __first_cmp_arg, unsigned int __auto_extent);
+
+MY_GLOBAL_API void my_multi_queue_uninit(my_multi_queue* __queue);
+
+MY_GLOBAL_API int my_multi_queue_insert(my_multi_queue* __queue, unsigned char* __element);
+
+MY_GLOBAL_API unsigned char* my_multi_queue_pop(my_multi_queue* __queue);
+
+MY_GLOBAL_API unsigned long long my_multi_queue_elements(my_multi_queue* __queue);
+
+C_MODE_END
+
+#endif //__MY_MULTI_QUEUE_H
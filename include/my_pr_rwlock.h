@@ -15,6 +15,7 @@
 #define __MY_PR_RWLOCK_H
 
 #include "my_global_exports.h"
+#include "my_pthread.h"
 
 C_MODE_START
 /**
@@ -46,9 +47,13 @@ C_MODE_START
 
   TODO/FIXME: We should consider alleviating this requirement as
   it blocks us from doing certain performance optimizations.
+
+  The lock is aligned on a cache line so that two locks never share one.
+  Allocate it with rw_pr_alloc() when it is not embedded in a structure
+  which is itself aligned.
 */
 
-typedef struct st_rw_pr_lock_t {
+typedef struct MY_ALIGNED(MY_CACHE_LINE_SIZE) st_rw_pr_lock_t {
     /**
       Lock which protects the structure.
       Also held for the duration of wr-lock.
@@ -60,11 +65,11 @@ typedef struct st_rw_pr_lock_t {
     */
     pthread_cond_t no_active_readers;
     /** Number of active readers. */
-    uint active_readers;
+    unsigned int active_readers;
     /** Number of writers waiting for readers to go away. */
-    uint writers_waiting_readers;
+    unsigned int writers_waiting_readers;
     /** Indicates whether there is an active writer. */
-    my_bool active_writer;
+    bool active_writer;
 } rw_pr_lock_t;
 
 MY_GLOBAL_API int rw_pr_init(rw_pr_lock_t *);
@@ -72,8 +77,10 @@ MY_GLOBAL_API int rw_pr_rdlock(rw_pr_lock_t *);
 MY_GLOBAL_API int rw_pr_wrlock(rw_pr_lock_t *);
 MY_GLOBAL_API int rw_pr_unlock(rw_pr_lock_t *);
 MY_GLOBAL_API int rw_pr_destroy(rw_pr_lock_t *);
+MY_GLOBAL_API rw_pr_lock_t *rw_pr_alloc(void);
+MY_GLOBAL_API void rw_pr_free(rw_pr_lock_t *);
 
-C_MODE_START
+C_MODE_END
 
 #endif  /* __MY_PR_RWLOCK_H */
 
@@ -220,6 +220,13 @@ typedef void *(* pthread_handler)(void *);
     #endif
 #endif
 
+/* Storage class for variables that have one instance per thread */
+#if defined(_WIN32)
+    #define MY_THREAD_LOCAL __declspec(thread)
+#else
+    #define MY_THREAD_LOCAL __thread
+#endif
+
 C_MODE_END
 
 #endif /* __MY_PTHREAD_H */
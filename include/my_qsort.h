@@ -1,7 +1,8 @@
 /*
  * Copyright (c) 2013, Heng Wang personal. All rights reserved.
- * 
- * 
+ *
+ * Sorting. Pattern-defeating quicksort for arrays of fixed size elements,
+ * with a specialized path for pointers and a multithreaded mode.
  *
  * @Author:  Heng.Wang
  * @Date  :  12/24/2013
@@ -10,13 +11,51 @@
  * @Github:  https://github.com/HengWang/
  * @Blog  :  http://hengwang.blog.chinaunix.net
  * */
- 
+
 #ifndef __MY_QSORT_H
 #define __MY_QSORT_H
-C_MODE_START
+
+#include <stddef.h>
 #include "my_global_exports.h"
 
+C_MODE_START
+
+/* Compare two elements, returns <0, 0 or >0 like strcmp() */
+typedef int (*qsort_cmp)(const void* a, const void* b);
+
+/* Same, with a context argument passed first */
+typedef int (*qsort_cmp2)(const void* arg, const void* a, const void* b);
+
+typedef qsort_cmp2 my_qsort_cmp;
+
+/* Inputs below this number of elements are always sorted by one thread */
+#define MY_QSORT_PARALLEL_MIN   (64 * 1024)
+#define MY_QSORT_MAX_THREADS    64
 
+/* Flags of the integer radix sorts */
+#define MY_RADIX_SIGNED         1   /* Keys are two's complement signed */
+#define MY_RADIX_DESC           2   /* Biggest key first */
+#define MY_RADIX_BYTES          4   /* my_array_radix_sort(): compare keys like memcmp() */
+
+/* Buckets below this number of elements are insertion sorted by the MSD sort */
+#define MY_RADIX_INSERTION_SORT 32
+
+MY_GLOBAL_API int my_qsort(void* __base, size_t __total, size_t __size, qsort_cmp __cmp);
+
+MY_GLOBAL_API int my_qsort2(void* __base, size_t __total, size_t __size, qsort_cmp2 __cmp, const void* __arg);
+
+MY_GLOBAL_API int my_qsort_parallel(void* __base, size_t __total, size_t __size, qsort_cmp2 __cmp,
+                                    const void* __arg, unsigned int __threads);
+
+MY_GLOBAL_API int my_radix_sort_u32(void* __base, size_t __total, size_t __size, size_t __offset,
+                                    unsigned int __flags, void* __scratch);
+
+MY_GLOBAL_API int my_radix_sort_u64(void* __base, size_t __total, size_t __size, size_t __offset,
+                                    unsigned int __flags, void* __scratch);
+
+MY_GLOBAL_API int my_radix_sort_bytes(void* __base, size_t __total, size_t __size, size_t __offset,
+                                      size_t __length, void* __scratch);
 
 C_MODE_END
-#endif  //__MY_QSORT_H
\ No newline at end of file
+
+#endif  //__MY_QSORT_H
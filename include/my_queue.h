@@ -25,6 +25,23 @@
 
 C_MODE_START
 
+#define MY_QUEUE_ARITY      4   /* Children per node of queue_set_arity(queue, 0) */
+#define MY_QUEUE_MAX_ARITY  16
+
+#define QUEUE_NOT_QUEUED    ((unsigned int) ~0U)  /* Position of a removed element */
+
+/*
+  Element idx has children ((idx - 1) << arity_shift) + 2 and up, its
+  parent is (idx + arity - 2) >> arity_shift. root[2], the first group of
+  children, starts a cache line, so every group of up to 8 children
+  shares one cache line.
+
+  With queue_set_key_prefix(), keys[idx] holds a prefix of the key of
+  root[idx], see queue_set_key_prefix().
+*/
+
+typedef unsigned long long (*queue_key_prefix)(void*, unsigned char*);
+
 typedef struct my_queue_t {
     unsigned char** root;
     void* first_cmp_arg;
@@ -34,6 +51,11 @@ typedef struct my_queue_t {
     int max_at_top;	/* Normally 1, set to -1 if queue_top gives max */
     int (*compare)(void *, unsigned char *,unsigned char *);
     unsigned int auto_extent;
+    unsigned int arity_shift;	/* log2 of children per node, 1 is binary */
+    unsigned long long* keys;	/* Key prefixes, NULL if not used */
+    queue_key_prefix key_prefix;
+    unsigned int offset_to_pos;	/* Position is kept at element+offset */
+    bool indexed;
 } my_queue;
 
 #define queue_top(queue) ((queue)->root[1])
@@ -42,6 +64,12 @@ typedef struct my_queue_t {
 #define queue_replaced(queue) _downheap(queue,1)
 #define queue_set_cmp_arg(queue, set_arg) (queue)->first_cmp_arg= set_arg
 #define queue_set_max_at_top(queue, set_arg) (queue)->max_at_top= set_arg ? -1 : 1
+#define queue_arity(queue) (1U << (queue)->arity_shift)
+#define queue_position(queue, element) \
+  (*(unsigned int*) ((element) + (queue)->offset_to_pos))
+#define queue_is_queued(queue, element) \
+  (queue_position(queue, element) < (queue)->elements && \
+   queue_element(queue, queue_position(queue, element)) == (element))
 
 typedef int (*queue_compare)(void*, unsigned char*, unsigned char*);
 
@@ -51,6 +79,15 @@ MY_GLOBAL_API int queue_init_ex(my_queue* queue, unsigned int max_elements, unsi
 	       bool max_at_top, queue_compare compare, void* first_cmp_arg, unsigned int auto_extent);
 MY_GLOBAL_API int queue_reinit(my_queue* queue,unsigned int max_elements, unsigned int offset_to_key,
                  bool max_at_top, queue_compare compare, void* first_cmp_arg);
+MY_GLOBAL_API int queue_set_arity(my_queue* queue, unsigned int arity);
+MY_GLOBAL_API int queue_set_key_prefix(my_queue* queue, queue_key_prefix key_prefix);
+MY_GLOBAL_API void queue_set_indexed(my_queue* queue, unsigned int offset_to_pos);
+MY_GLOBAL_API void queue_update(my_queue* queue, unsigned char* element);
+MY_GLOBAL_API unsigned char* queue_remove_element(my_queue* queue, unsigned char* element);
+MY_GLOBAL_API unsigned char* queue_replace_top(my_queue* queue, unsigned char* element);
+MY_GLOBAL_API unsigned char* queue_offer(my_queue* queue, unsigned char* element);
+MY_GLOBAL_API unsigned int queue_offer_many(my_queue* queue, unsigned char** elements, unsigned int count);
+MY_GLOBAL_API unsigned int queue_drain_sorted(my_queue* queue, unsigned char** to);
 MY_GLOBAL_API int queue_resize(my_queue* queue, unsigned int max_elements);
 MY_GLOBAL_API void queue_delete(my_queue* queue);
 MY_GLOBAL_API void queue_insert(my_queue* queue, unsigned char* element);
@@ -58,10 +95,12 @@ MY_GLOBAL_API int queue_insert_safe(my_queue* queue, unsigned char* element);
 MY_GLOBAL_API unsigned char* queue_remove(my_queue* queue, unsigned int idx);
 #define queue_remove_all(queue) { (queue)->elements = 0; }
 #define queue_is_full(queue) (queue->elements == queue->max_elements)
-//MY_GLOBAL_API void _downheap(my_queue *queue,unsigned int idx);
+MY_GLOBAL_API void _downheap(my_queue *queue,unsigned int idx);
 MY_GLOBAL_API void queue_fix(my_queue *queue);
+MY_GLOBAL_API int queue_insert_many(my_queue* queue, unsigned char** elements, unsigned int count);
+MY_GLOBAL_API int queue_build(my_queue* queue, unsigned char** elements, unsigned int count);
 #define is_queue_inited(queue) ((queue)->root != 0)
 
-C_MODE_START
+C_MODE_END
 
 #endif  /* __MY_QUEUE_H */
@@ -15,6 +15,9 @@
 #define __MY_RBTREE_H
 
 #include "my_global_exports.h"
+#include "my_alloc.h"
+#include "my_qsort.h"
+#include "my_mem_pool.h"
 
 C_MODE_START
 
@@ -22,6 +25,7 @@ C_MODE_START
 #define MAX_rbtree_HEIGHT	64
 
 #define rbtree_NO_DUPLICATES 1
+#define rbtree_LIMIT_REACHED 2  /* Set when an insert was refused by the memory pool */
 
 #define ELEMENT_KEY(tree,element)\
 (tree->offset ? (void*)((uchar*) element+tree->offset) :\
@@ -77,6 +81,8 @@ typedef struct rbtree_t {
     unsigned int size;
     unsigned long memory_limit;
     unsigned long allocated;
+    my_mem_pool* pool;              /* Budget the elements are charged to */
+    my_mem_pool own_pool;           /* Used when memory_limit is given */
     my_qsort_cmp compare;
     const void* context;
     MEM_ROOT mem_root;
@@ -94,6 +100,8 @@ MY_GLOBAL_API void rbtree_uninit(rbtree*);
 
 MY_GLOBAL_API void rbtree_reset(rbtree*);
 
+MY_GLOBAL_API int rbtree_set_pool(rbtree* tree, my_mem_pool* pool);
+
 	/* Functions on leafs */
 MY_GLOBAL_API rbtree_element *rbtree_insert(rbtree* tree,void* key, unsigned int key_size, const void* context);
 
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Vectorized scans. Find, count and filter the elements of an array whose
+ * 8, 16, 32 or 64 bit integer field compares to a value.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_SCAN_H
+#define __MY_SCAN_H
+
+#include <stddef.h>
+#include "my_global_exports.h"
+
+C_MODE_START
+
+/* Comparisons, field OP value */
+#define MY_SCAN_EQ          0
+#define MY_SCAN_NE          1
+#define MY_SCAN_LT          2
+#define MY_SCAN_LE          3
+#define MY_SCAN_GT          4
+#define MY_SCAN_GE          5
+
+/* Or'ed to the comparison: the field is unsigned */
+#define MY_SCAN_UNSIGNED    8
+
+/* Instruction sets, see my_scan_isa() */
+#define MY_SCAN_ISA_SCALAR  0
+#define MY_SCAN_ISA_SSE2    1
+#define MY_SCAN_ISA_AVX2    2
+
+MY_GLOBAL_API size_t my_scan_find(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                                  unsigned int __op, unsigned long long __value);
+
+MY_GLOBAL_API size_t my_scan_count(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                                   unsigned int __op, unsigned long long __value);
+
+MY_GLOBAL_API size_t my_scan_filter(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                                    unsigned int __op, unsigned long long __value, unsigned int* __rows);
+
+MY_GLOBAL_API unsigned int my_scan_isa(void);
+
+MY_GLOBAL_API unsigned int my_scan_set_isa(unsigned int __isa);
+
+C_MODE_END
+
+#endif  //__MY_SCAN_H
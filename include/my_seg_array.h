@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Segmented array. Elements live in segments of doubling size which are
+ * never moved, so pointers to elements stay valid while the array grows.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_SEG_ARRAY_H
+#define __MY_SEG_ARRAY_H
+
+#include "my_global_exports.h"
+#include "my_bit.h"
+
+C_MODE_START
+
+#define MY_SEG_ARRAY_SEGMENTS   32  /* Size of the segment directory */
+#define MY_SEG_ARRAY_MIN_SHIFT  4   /* Smallest first segment, 16 elements */
+
+/*
+  Segment 0 holds base = 1 << shift elements and segment k > 0 holds
+  base << (k - 1), so segments 0..k hold base << k elements together and
+  the segment of an element is found from the highest bit of its index.
+*/
+
+struct my_seg_array_t
+{
+  unsigned char* segments[MY_SEG_ARRAY_SEGMENTS];
+  unsigned int elements;  /* Elements in use */
+  unsigned int number;    /* Elements allocated */
+  unsigned int size;      /* Size of one element */
+  unsigned int shift;     /* log2 of the size of segment 0 */
+};
+
+typedef struct my_seg_array_t my_seg_array;
+
+#define my_seg_array_reset(array) ((array)->elements= 0)
+
+/* Segment holding element idx, and the index of the element in it */
+
+static inline unsigned int my_seg_array_segment(const my_seg_array* __array, unsigned int __idx,
+                                                unsigned int* __offset)
+{
+    unsigned int segment;
+    unsigned int high = __idx >> __array->shift;
+
+    if (!high)
+    {
+        *__offset = __idx;
+        return 0;
+    }
+    segment = my_bit_log2(high) + 1;
+    *__offset = __idx - (1U << (__array->shift + segment - 1));
+    return segment;
+}
+
+/* Address of element idx, which must be below number */
+
+static inline void* my_seg_array_element(const my_seg_array* __array, unsigned int __idx)
+{
+    unsigned int offset;
+    unsigned int segment = my_seg_array_segment(__array, __idx, &offset);
+
+    return __array->segments[segment] + (size_t) offset * __array->size;
+}
+
+MY_GLOBAL_API my_seg_array* my_seg_array_init(unsigned int __number, unsigned int __size);
+
+MY_GLOBAL_API void my_seg_array_uninit(my_seg_array* __array);
+
+MY_GLOBAL_API int my_seg_array_reserve(my_seg_array* __array, unsigned int __number);
+
+MY_GLOBAL_API void* my_seg_array_alloc(my_seg_array* __array);
+
+MY_GLOBAL_API int my_seg_array_insert(my_seg_array* __array, const void* __element);
+
+MY_GLOBAL_API int my_seg_array_append(my_seg_array* __array, const void* __elements, unsigned int __count);
+
+MY_GLOBAL_API void* my_seg_array_pop(my_seg_array* __array);
+
+MY_GLOBAL_API int my_seg_array_get(my_seg_array* __array, void* __element, unsigned int __idx);
+
+MY_GLOBAL_API int my_seg_array_set(my_seg_array* __array, const void* __element, unsigned int __idx);
+
+MY_GLOBAL_API void my_seg_array_free(my_seg_array* __array);
+
+C_MODE_END
+
+#endif //__MY_SEG_ARRAY_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Hierarchical timing wheel. Timers are armed and cancelled in constant
+ * time and expire in batches as the wheel advances.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+#ifndef __MY_TIMER_WHEEL_H
+#define __MY_TIMER_WHEEL_H
+
+#include "my_global_exports.h"
+
+C_MODE_START
+
+#define MY_TIMER_WHEEL_LEVELS       4   /* Default number of levels */
+#define MY_TIMER_WHEEL_SLOT_BITS    8   /* Default log2 of slots per level */
+#define MY_TIMER_WHEEL_MAX_LEVELS   8
+#define MY_TIMER_WHEEL_MAX_SLOT_BITS 16
+#define MY_TIMER_WHEEL_BATCH        64  /* Timers per call of the expire function */
+
+/*
+  Timer node, embedded in the caller's structure. It is linked in the
+  slot of the wheel where it waits, so arming and cancelling only
+  relink it.
+*/
+
+struct my_timer_t
+{
+  struct my_timer_t* next;
+  struct my_timer_t** pprev;    /* Link pointing to this timer, NULL if not armed */
+  unsigned long long expires;   /* Expiry, in ticks */
+  unsigned int level;           /* Level of the slot it waits in */
+};
+
+typedef struct my_timer_t my_timer;
+
+/* Called with count expired timers, which are no longer armed */
+typedef void (*my_timer_expire_func)(void* arg, my_timer** timers, unsigned int count);
+
+/*
+  Level l has 1 << slot_bits slots of 1 << (l * slot_bits) ticks each.
+  A timer waits in the lowest level whose range covers its delay and
+  moves down a level (cascades) when the wheel reaches its slot.
+*/
+
+struct my_timer_wheel_t
+{
+  my_timer** slots;             /* levels << slot_bits list heads */
+  unsigned long long current;   /* Current tick */
+  unsigned int tick;            /* Time units per tick */
+  unsigned int levels;
+  unsigned int slot_bits;
+  unsigned int timers;          /* Armed timers */
+  unsigned int counts[MY_TIMER_WHEEL_MAX_LEVELS];   /* Timers per level */
+};
+
+typedef struct my_timer_wheel_t my_timer_wheel;
+
+#define my_timer_init(timer) ((timer)->pprev= NULL)
+#define my_timer_is_armed(timer) ((timer)->pprev != NULL)
+#define my_timer_wheel_timers(wheel) ((wheel)->timers)
+#define my_timer_wheel_now(wheel) ((wheel)->current * (wheel)->tick)
+
+MY_GLOBAL_API my_timer_wheel* my_timer_wheel_init(unsigned int __tick, unsigned int __levels,
+                                                  unsigned int __slot_bits, unsigned long long __now);
+
+MY_GLOBAL_API void my_timer_wheel_uninit(my_timer_wheel* __wheel);
+
+MY_GLOBAL_API void my_timer_wheel_arm(my_timer_wheel* __wheel, my_timer* __timer, unsigned long long __expires);
+
+MY_GLOBAL_API void my_timer_wheel_cancel(my_timer_wheel* __wheel, my_timer* __timer);
+
+MY_GLOBAL_API unsigned int my_timer_wheel_advance(my_timer_wheel* __wheel, unsigned long long __now,
+                                                  my_timer_expire_func __func, void* __arg);
+
+C_MODE_END
+
+#endif //__MY_TIMER_WHEEL_H
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Block-chained memory arena (MEM_ROOT).
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  Routines to handle mallocing of results which will be freed the same time.
+
+  Memory is taken from the system in blocks. A block stays on the 'free'
+  list while it has room for at least min_malloc more bytes, and is moved
+  to the 'used' list once it is (almost) full. Every new block is bigger
+  than the previous one (block_size * block_num / 4), so building a
+  structure with millions of small objects only costs a handful of
+  malloc() calls, and freeing it costs one my_free() per block.
+*/
+
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_alloc.h"
+
+#define USED_MEM_HEADER ALLOC_ALIGN(sizeof(USED_MEM))
+
+/*
+  Initialize memory root
+
+  SYNOPSIS
+    init_alloc_root()
+      tag            - enum my_memory_tag the blocks are accounted to
+      mem_root       - memory root to initialize
+      block_size     - size of chunks (blocks) used for memory allocation
+                       (It is external size of chunk i.e. it should include
+                        memory required for internal structures, thus it
+                        should be no less than ALLOC_ROOT_MIN_BLOCK_SIZE)
+      pre_alloc_size - if non-0, then size of block that should be
+                       pre-allocated during memory root initialization.
+
+  DESCRIPTION
+    This function prepares memory root for further use, sets initial size of
+    chunk for memory allocation and pre-allocates first block if specified.
+    Altough error can happen during execution of this function if
+    pre_alloc_size is non-0 it won't be reported. Instead it will be
+    reported as error in first alloc_root() on this memory root.
+*/
+
+MY_GLOBAL_API void init_alloc_root(unsigned int tag, MEM_ROOT* mem_root, size_t block_size, size_t pre_alloc_size)
+{
+    mem_root->free = mem_root->used = mem_root->pre_alloc = 0;
+    mem_root->min_malloc = 32;
+    block_size = MAX(block_size, ALLOC_ROOT_MIN_BLOCK_SIZE + USED_MEM_HEADER);
+    mem_root->block_size = ALLOC_ALIGN(block_size) - ALLOC_ROOT_MIN_BLOCK_SIZE;
+    mem_root->error_handler = 0;
+    mem_root->block_num = 4;			/* We shift this with >>2 */
+    mem_root->first_block_usage = 0;
+    mem_root->allocated = 0;
+    mem_root->tag = tag;
+
+    if (pre_alloc_size)
+    {
+        size_t size = pre_alloc_size + USED_MEM_HEADER;
+        if ((mem_root->free = mem_root->pre_alloc = (USED_MEM*) my_malloc_ex(size, mem_root->tag)))
+        {
+            mem_root->free->size = size;
+            mem_root->free->left = pre_alloc_size;
+            mem_root->free->next = 0;
+            mem_root->allocated += size;
+        }
+    }
+}
+
+
+/*
+  Allocate a chunk of length bytes from the memory root
+
+  SYNOPSIS
+    alloc_root()
+      mem_root    - memory root to allocate from
+      length      - wanted number of bytes
+
+  DESCRIPTION
+    The first block on the free list which has room for the request is used.
+    If the first block repeatedly fails to satisfy requests it is moved to
+    the used list, so that a nearly full block does not slow down every
+    following allocation. When no block fits, a new one of
+    block_size * (block_num >> 2) bytes (or bigger, for huge requests) is
+    allocated and linked at the end of the free list.
+
+  RETURN
+    pointer	Ok, memory is aligned on ALLOC_ALIGN_SIZE
+    0		Out of memory
+*/
+
+MY_GLOBAL_API void* alloc_root(MEM_ROOT* mem_root, size_t length)
+{
+    size_t get_size, block_size;
+    unsigned char* point;
+    USED_MEM* next = 0;
+    USED_MEM** prev;
+
+    length = ALLOC_ALIGN(length);
+    if ((*(prev = &mem_root->free)) != NULL)
+    {
+        if ((*prev)->left < length &&
+            mem_root->first_block_usage++ >= ALLOC_MAX_BLOCK_USAGE_BEFORE_DROP &&
+            (*prev)->left < ALLOC_MAX_BLOCK_TO_DROP)
+        {
+            next = *prev;
+            *prev = next->next;			/* Remove block from list */
+            next->next = mem_root->used;
+            mem_root->used = next;
+            mem_root->first_block_usage = 0;
+        }
+        for (next = *prev; next && next->left < length; next = next->next)
+            prev = &next->next;
+    }
+    if (!next)
+    {						/* Time to alloc new block */
+        block_size = mem_root->block_size * (mem_root->block_num >> 2);
+        get_size = length + USED_MEM_HEADER;
+        get_size = MAX(get_size, block_size);
+
+        if (!(next = (USED_MEM*) my_malloc_ex(get_size, mem_root->tag)))
+        {
+            if (mem_root->error_handler)
+                (*mem_root->error_handler)();
+            return NULL;
+        }
+        mem_root->block_num++;
+        mem_root->allocated += get_size;
+        next->next = *prev;
+        next->size = get_size;
+        next->left = get_size - USED_MEM_HEADER;
+        *prev = next;
+    }
+
+    point = (unsigned char*) ((char*) next + (next->size - next->left));
+    if ((next->left -= length) < mem_root->min_malloc)
+    {						/* Full block */
+        *prev = next->next;				/* Remove block from list */
+        next->next = mem_root->used;
+        mem_root->used = next;
+        mem_root->first_block_usage = 0;
+    }
+    return (void*) point;
+}
+
+
+/*
+  Mark all data in blocks free for reusage
+
+  SYNOPSIS
+    mark_blocks_free()
+      root          Memory root
+
+  DESCRIPTION
+    The used list is appended to the free list and every block is reset to
+    be empty. No memory is returned to the system, so the next round of
+    allocations is served from the same blocks.
+*/
+
+static inline void mark_blocks_free(MEM_ROOT* root)
+{
+    USED_MEM* next;
+    USED_MEM** last;
+
+    /* iterate through (partially) free blocks, mark them free */
+    last = &root->free;
+    for (next = root->free; next; next = *(last = &next->next))
+        next->left = next->size - USED_MEM_HEADER;
+
+    /* Combine the free and the used list */
+    *last = next = root->used;
+
+    /* now go through the used blocks and mark them free */
+    for (; next; next = next->next)
+        next->left = next->size - USED_MEM_HEADER;
+
+    /* Now everything is set; Indicate that nothing is used anymore */
+    root->used = 0;
+    root->first_block_usage = 0;
+}
+
+
+/*
+  Deallocate everything used by alloc_root or just move
+  used blocks to free list if called with MY_MARK_BLOCKS_FREE
+
+  SYNOPSIS
+    free_root()
+      root		Memory root
+      flags		Flags for what should be freed:
+
+        MY_MARK_BLOCKS_FREE	Don't free blocks, just mark them free
+        MY_KEEP_PREALLOC	If this is not set, then free also the
+                                preallocated block
+
+  NOTES
+    One can call this function either with root block initialised with
+    init_alloc_root() or with a zero()-ed block.
+    It's also safe to call this multiple times with the same mem_root.
+    The cost is one my_free() per block, independent of the number of
+    objects allocated from the root.
+*/
+
+MY_GLOBAL_API void free_root(MEM_ROOT* root, int flags)
+{
+    USED_MEM* next;
+    USED_MEM* old;
+
+    if (flags & MY_MARK_BLOCKS_FREE)
+    {
+        mark_blocks_free(root);
+        return;
+    }
+    if (!(flags & MY_KEEP_PREALLOC))
+        root->pre_alloc = 0;
+
+    for (next = root->used; next;)
+    {
+        old = next; next = next->next;
+        if (old != root->pre_alloc)
+            my_free(old);
+    }
+    for (next = root->free; next;)
+    {
+        old = next; next = next->next;
+        if (old != root->pre_alloc)
+            my_free(old);
+    }
+    root->used = root->free = 0;
+    root->allocated = 0;
+    if (root->pre_alloc)
+    {
+        root->free = root->pre_alloc;
+        root->free->left = root->pre_alloc->size - USED_MEM_HEADER;
+        root->free->next = 0;
+        root->allocated = root->pre_alloc->size;
+    }
+    root->block_num = 4;
+    root->first_block_usage = 0;
+}
+
+
+/*
+  Change default block size and pre-allocated block size
+
+  SYNOPSIS
+    reset_root_defaults()
+    mem_root        memory root to change defaults of
+    block_size      new value of block size. Must be greater or equal
+                    than ALLOC_ROOT_MIN_BLOCK_SIZE (this value is about
+                    68 bytes and depends on platform and compilation flags)
+    pre_alloc_size  new size of preallocated block. If not zero,
+                    must be equal to or greater than block size,
+                    otherwise means 'no prealloc'.
+
+  DESCRIPTION
+    Function aligns and assigns new value to block size; then it tries to
+    reuse one of existing blocks as prealloc block, or malloc new one of
+    requested size. If no blocks can be reused, all unused blocks are freed
+    before allocation.
+*/
+
+MY_GLOBAL_API void reset_root_defaults(MEM_ROOT* mem_root, size_t block_size, size_t pre_alloc_size)
+{
+    USED_MEM* mem;
+    USED_MEM** prev;
+    size_t size;
+
+    block_size = MAX(block_size, ALLOC_ROOT_MIN_BLOCK_SIZE + USED_MEM_HEADER);
+    mem_root->block_size = ALLOC_ALIGN(block_size) - ALLOC_ROOT_MIN_BLOCK_SIZE;
+    if (!pre_alloc_size)
+    {
+        mem_root->pre_alloc = 0;
+        return;
+    }
+
+    size = pre_alloc_size + USED_MEM_HEADER;
+    if (mem_root->pre_alloc && mem_root->pre_alloc->size == size)
+        return;
+
+    prev = &mem_root->free;
+    /*
+      Free unused blocks, so that consequent calls
+      to reset_root_defaults won't eat away memory.
+    */
+    while (*prev)
+    {
+        mem = *prev;
+        if (mem->size == size)
+        {
+            /* We found a suitable block, no need to do anything else */
+            mem_root->pre_alloc = mem;
+            return;
+        }
+        if (mem->left + USED_MEM_HEADER == mem->size)
+        {
+            /* remove block from the list and free it */
+            *prev = mem->next;
+            mem_root->allocated -= mem->size;
+            my_free(mem);
+        }
+        else
+            prev = &mem->next;
+    }
+    /* Allocate new prealloc block and add it to the end of free list */
+    if ((mem = (USED_MEM*) my_malloc_ex(size, mem_root->tag)))
+    {
+        mem->size = size;
+        mem->left = pre_alloc_size;
+        mem->next = *prev;
+        *prev = mem_root->pre_alloc = mem;
+        mem_root->allocated += size;
+    }
+    else
+        mem_root->pre_alloc = 0;
+}
+
+
+MY_GLOBAL_API void* memdup_root(MEM_ROOT* root, const void* str, size_t len)
+{
+    char* pos;
+
+    if ((pos = (char*) alloc_root(root, len)))
+        memcpy(pos, str, len);
+    return pos;
+}
+
+
+MY_GLOBAL_API char* strdup_root(MEM_ROOT* root, const char* str)
+{
+    return (char*) memdup_root(root, str, strlen(str) + 1);
+}
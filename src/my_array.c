@@ -11,6 +11,9 @@
  * @Blog  :  http://hengwang.blog.chinaunix.net
  * */
 
+#include <limits.h>
+#include <string.h>
+
 #include "my_global_exports.h"
 #include "my_array.h"
 #include "my_malloc.h"
@@ -19,53 +22,61 @@
   Initiate dynamic array
 
   SYNOPSIS
-    init_my_array2()
-      array		Pointer to an array
-      element_size	Size of element
-      init_buffer       Initial buffer pointer
-      init_alloc	Number of initial elements
-      alloc_increment	Increment for adding new elements
+    my_array_init()
+      buffer		Initial buffer, owned by the caller, or NULL
+      number		Number of initial elements
+      increment		Increment for adding new elements, 0 for default
+      size		Size of element
 
   DESCRIPTION
-    init_my_array() initiates array and allocate space for 
-    init_alloc eilements. 
-    Array is usable even if space allocation failed, hence, the
-    function never returns TRUE.
-    Static buffers must begin immediately after the array structure.
+    my_array_init() allocates an array and space for number elements,
+    unless a buffer is given. A caller's buffer is never freed or
+    reallocated; it is copied into a new buffer on the first growth.
+    The array grows geometrically by MY_ARRAY_GROW_FACTOR percent, at
+    least increment elements at a time, see my_array_set_growth().
 
   RETURN VALUE
-    FALSE	Ok
+    pointer	Ok
+    NULL	Out of memory
 */
 
 MY_GLOBAL_API my_array* my_array_init(void*__buffer, unsigned __number, 
                                         unsigned int __increment, unsigned int __size)
 {
     my_array* array;
-	if(!(array = my_calloc(sizeof(my_array))))
-	    return NULL;
-    if(!__increment)
-	{
-	    __increment = MAX((ARRAT_BLOCK_SIZE - MALLOC_OVERHEAD)/__size, ARRAY_INIT_INCREMENT);
-		if(__number > ARRAY_INIT_NUMBER && __increment > __number * 2)
-		    __increment = __number * 2
-	}
-	if(!__number)
-	{
-	    __number = __increment;
-		__buffer = NULL;
-	}
-	array->elements = 0;
-	array->number = __number;
-	array->increment = __increment;
-	array->size = __size;
-	if(array->buffer = __buffer)
-	    return array;
-	if (!(array->buffer = (void*)my_malloc(__size * __number)))
-    {    
-		array->__number=0;
-	    return NULL;
-	}
-	return array;
+
+    if (!(array = my_malloc_padded_ex(sizeof(my_array), MY_MEM_ARRAY)))
+        return NULL;
+    memset(array, 0, sizeof(my_array));
+    if (!__increment)
+    {
+        __increment = MAX((ARRAT_BLOCK_SIZE - MALLOC_OVERHEAD)/__size, ARRAY_INIT_INCREMENT);
+        if (__number > ARRAY_INIT_NUMBER && __increment > __number * 2)
+            __increment = __number * 2;
+    }
+    if (!__number)
+    {
+        __number = __increment;
+        __buffer = NULL;
+    }
+    array->elements = 0;
+    array->number = __number;
+    array->size = __size;
+    array->growth.policy = MY_ARRAY_GROW_GEOMETRIC;
+    array->growth.factor = MY_ARRAY_GROW_FACTOR;
+    array->growth.increment = __increment;
+    array->growth.max_increment = 0;
+    if ((array->buffer = (unsigned char*) __buffer))
+    {
+        array->flags |= MY_ARRAY_INIT_BUFFER_USED;
+        return array;
+    }
+    if (!(array->buffer = (unsigned char*) my_malloc_ex((size_t) __size * __number, MY_MEM_ARRAY)))
+    {
+        my_free(array);
+        return NULL;
+    }
+    return array;
 }
 
 
@@ -73,12 +84,12 @@ MY_GLOBAL_API my_array* my_array_init(void*__buffer, unsigned __number,
   Empty array by freeing all memory
 
   SYNOPSIS
-    delete_dynamic()
+    my_array_uninit()
       array	Array to be deleted
 */
 MY_GLOBAL_API void my_array_uninit(my_array* __array)
 {
-    if(__array->buffer == (unsigned char*)(__array + 1))
+    if (__array->flags & MY_ARRAY_INIT_BUFFER_USED)
 	{
 	    __array->elements = 0;
 	} else {
@@ -93,11 +104,150 @@ MY_GLOBAL_API void my_array_uninit(my_array* __array)
 }
 
 
+/*
+  Select how the array grows
+
+  SYNOPSIS
+    my_array_set_growth()
+      array
+      policy		MY_ARRAY_GROW_FIXED, MY_ARRAY_GROW_GEOMETRIC or
+                        MY_ARRAY_GROW_CAPPED
+      factor		Growth factor in percent, 0 for MY_ARRAY_GROW_FACTOR
+      max_increment	Largest step of MY_ARRAY_GROW_CAPPED, in elements
+
+  NOTES
+    Fixed growth costs O(N^2/increment) copies to append N elements, it
+    only suits arrays of known, small size. Geometric growth costs O(N)
+    copies but may leave up to factor-100 percent of the buffer unused;
+    capped growth bounds that waste for very large arrays.
+*/
+
+MY_GLOBAL_API void my_array_set_growth(my_array* __array, unsigned int __policy,
+                                        unsigned int __factor, unsigned int __max_increment)
+{
+    __array->growth.policy = __policy;
+    __array->growth.factor = __factor > 100 ? __factor : MY_ARRAY_GROW_FACTOR;
+    __array->growth.max_increment = __max_increment;
+}
+
+
+/*
+  Compute the new number of elements of a growing array
+
+  SYNOPSIS
+    my_array_grow()
+      growth	Growth policy
+      number	Elements allocated now
+      wanted	Elements needed
+
+  RETURN VALUE
+    Number of elements to allocate, at least wanted
+*/
+
+MY_GLOBAL_API unsigned int my_array_grow(const my_array_growth* __growth, unsigned int __number,
+                                          unsigned int __wanted)
+{
+    unsigned long long size;
+    unsigned int increment = MAX(__growth->increment, 1);
+
+    if (__growth->policy == MY_ARRAY_GROW_FIXED)
+    {
+        /* Round up to a multiple of increment, like it always did */
+        size = ((unsigned long long) __wanted + increment - 1) / increment * increment;
+    }
+    else
+    {
+        size = (unsigned long long) __number * __growth->factor / 100;
+        size = MAX(size, (unsigned long long) __number + increment);
+        if (__growth->policy == MY_ARRAY_GROW_CAPPED && __growth->max_increment &&
+            size > (unsigned long long) __number + __growth->max_increment)
+            size = (unsigned long long) __number + MAX(__growth->max_increment, increment);
+        size = MAX(size, __wanted);
+    }
+    return size > UINT_MAX ? UINT_MAX : (unsigned int) size;
+}
+
+
+/*
+  Resize the buffer to exactly number elements
+*/
+
+static int array_resize(my_array* __array, unsigned int __number)
+{
+    unsigned char* buffer;
+    size_t length = (size_t) __number * __array->size;
+
+    if (__array->flags & MY_ARRAY_INIT_BUFFER_USED)
+    {
+        if (!(buffer = (unsigned char*) my_malloc_ex(length, MY_MEM_ARRAY)))
+            return 1;
+        memcpy(buffer, __array->buffer, (size_t) MIN(__array->elements, __number) * __array->size);
+        __array->flags &= ~MY_ARRAY_INIT_BUFFER_USED;
+    }
+    else if (!(buffer = (unsigned char*) my_realloc_ex(__array->buffer, length, MY_MEM_ARRAY)))
+        return 1;
+    __array->buffer = buffer;
+    __array->number = __number;
+    return 0;
+}
+
+
+/*
+  Ensure that dynamic array has enough elements
+
+  SYNOPSIS
+    my_array_allocate()
+    array
+    number        Numbers of elements that is needed
+
+  NOTES
+   Any new allocated element are NOT initialized. The buffer grows
+   following the growth policy of the array.
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Allocation of new memory failed
+*/
+
+static int my_array_allocate(my_array* __array, unsigned int __number)
+{
+    if (__number <= __array->number)
+        return 0;
+    return array_resize(__array, my_array_grow(&__array->growth, __array->number, __number));
+}
+
+
+/*
+  Make room for a number of elements
+
+  SYNOPSIS
+    my_array_reserve()
+      array
+      number	Number of elements the array must be able to hold
+
+  DESCRIPTION
+    Unlike growth on demand, the buffer is sized to exactly number
+    elements, so a caller knowing the final size pays for one
+    allocation and wastes nothing. Never shrinks the array.
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Allocation of new memory failed
+*/
+
+MY_GLOBAL_API int my_array_reserve(my_array* __array, unsigned int __number)
+{
+    if (__number <= __array->number)
+        return 0;
+    return array_resize(__array, __number);
+}
+
+
 /*
   Insert element at the end of array. Allocate memory if needed.
 
   SYNOPSIS
-    insert_dynamic()
+    my_array_insert()
       array
       element
 
@@ -107,30 +257,24 @@ MY_GLOBAL_API void my_array_uninit(my_array* __array)
 */
 MY_GLOBAL_API int my_array_insert(my_array* __array, const void* __element)
 {
-    unsigned char* buffer;
-	if(__array->elements == __array->number)
-	{
-	    if(!(buffer = my_array_alloc(__array)))
-		    return 1;
-	} else {
-	    buffer = __array->buffer+(__array->elements * __array->size);
-		__array->elements++;
-	}
-	memcpy(buffer, __element, (size_t)array->size);
-	return 0;
+    void* buffer;
+
+    if (!(buffer = my_array_alloc(__array)))
+        return 1;
+    memcpy(buffer, __element, (size_t) __array->size);
+    return 0;
 }
 
 /*
   Alloc space for next element(s) 
 
   SYNOPSIS
-    alloc_dynamic()
+    my_array_alloc()
       array
 
   DESCRIPTION
-    alloc_dynamic() checks if there is empty space for at least
-    one element if not tries to allocate space for alloc_increment
-    elements at the end of array.
+    my_array_alloc() checks if there is empty space for at least
+    one element if not grows the array following its growth policy.
 
   RETURN VALUE
     pointer	Pointer to empty space for element
@@ -139,29 +283,82 @@ MY_GLOBAL_API int my_array_insert(my_array* __array, const void* __element)
 
 MY_GLOBAL_API void* my_array_alloc(my_array* __array)
 {
-    char* buffer;
-    if(__array->elements == __array->number)
-	{
-	    if(__array->buffer == (unsigned char*)(__array + 1))
-		{
-		    if(!(buffer = (char*) my_malloc((__array->number + __array->increment) * __array->size)))
-			    return NULL;
- 		    memcpy(buffer, __array->buffer, __array->elements * __array->size);
-		} else {
-		    if (!(buffer = (char*) my_realloc(__array->buffer, (__array->number + __array->increment) * __array->size)))
-                return NULL;
-		}
-		__array->buffer= (unsigned char*) buffer;
-        __array->number += __array->increment;
-	}
-	return __array->buffer + (__array->elements++ * __array->size);
+    if (__array->elements == __array->number &&
+        my_array_allocate(__array, __array->elements + 1))
+        return NULL;
+    return __array->buffer + ((size_t) __array->elements++ * __array->size);
+}
+
+/*
+  Append elements at the end of array
+
+  SYNOPSIS
+    my_array_append()
+      array
+      elements	count elements laid out like in the array
+      count	Number of elements
+
+  DESCRIPTION
+    Grows the array once, following its growth policy, and copies all
+    elements with one memcpy.
+
+  RETURN VALUE
+    TRUE	Out of memory, the array is unchanged
+    FALSE	Ok
+*/
+
+MY_GLOBAL_API int my_array_append(my_array* __array, const void* __elements, unsigned int __count)
+{
+    if (__count > UINT_MAX - __array->elements ||
+        my_array_allocate(__array, __array->elements + __count))
+        return 1;
+    memcpy(__array->buffer + (size_t) __array->elements * __array->size, __elements,
+           (size_t) __count * __array->size);
+    __array->elements += __count;
+    return 0;
+}
+
+
+/*
+  Insert elements before a given index
+
+  SYNOPSIS
+    my_array_insert_range()
+      array
+      idx	Position of the first inserted element, at most elements
+      elements	count elements laid out like in the array
+      count	Number of elements
+
+  DESCRIPTION
+    The tail of the array is moved once, whatever the number of
+    inserted elements.
+
+  RETURN VALUE
+    TRUE	Out of memory or idx out of range, the array is unchanged
+    FALSE	Ok
+*/
+
+MY_GLOBAL_API int my_array_insert_range(my_array* __array, unsigned int __idx,
+                                         const void* __elements, unsigned int __count)
+{
+    unsigned char* ptr;
+
+    if (__idx > __array->elements || __count > UINT_MAX - __array->elements ||
+        my_array_allocate(__array, __array->elements + __count))
+        return 1;
+    ptr = __array->buffer + (size_t) __idx * __array->size;
+    memmove(ptr + (size_t) __count * __array->size, ptr,
+            (size_t) (__array->elements - __idx) * __array->size);
+    memcpy(ptr, __elements, (size_t) __count * __array->size);
+    __array->elements += __count;
+    return 0;
 }
 
 /*
   Pop last element from array.
 
   SYNOPSIS
-    pop_dynamic()
+    my_array_pop()
       array
   
   RETURN VALUE    
@@ -171,21 +368,21 @@ MY_GLOBAL_API void* my_array_alloc(my_array* __array)
 MY_GLOBAL_API void* my_array_pop(my_array* __array)
 {
     if(__array->elements)
-        return __array->buffer + (--__array->elements * __array->size);
-	return NULL;
+        return __array->buffer + ((size_t) --__array->elements * __array->size);
+    return NULL;
 }
 
 /*
   Replace element in array with given element and index
 
   SYNOPSIS
-    set_dynamic()
+    my_array_set()
       array
       element	Element to be inserted
       idx	Index where element is to be inserted
 
   DESCRIPTION
-    set_dynamic() replaces element in array. 
+    my_array_set() replaces element in array. 
     If idx > max_element insert new element. Allocate memory if needed. 
  
   RETURN VALUE
@@ -196,92 +393,262 @@ MY_GLOBAL_API int my_array_set(my_array* __array, const void* __element, unsigne
 {
     if(__idx >= __array->elements)
     {
-	    if(__idx >= __array->number && my_array_allocate(__array, __idx))
+	    if(__idx >= __array->number && my_array_allocate(__array, __idx + 1))
 		{
 		    return 1;
 		}
-		memset((__array->buffer + __array->elements * __array->size), 0, (__idx - __array->elements) * __array->size);
-		array->elements = __idx + 1;
+		memset((__array->buffer + (size_t) __array->elements * __array->size), 0,
+		       (size_t) (__idx - __array->elements) * __array->size);
+		__array->elements = __idx + 1;
     }
-	memcpy(__array->buffer + (__idx * __array->size), __element, (size_t) __array->size);
+	memcpy(__array->buffer + ((size_t) __idx * __array->size), __element, (size_t) __array->size);
 	return 0;
 }
 
 
 /*
-  Ensure that dynamic array has enough elements
+  Get an element from array by given index
 
   SYNOPSIS
-    allocate_dynamic()
-    array
-    max_elements        Numbers of elements that is needed
+    my_array_get()
+      array	
+      element	Element to be returned. If idx > elements contain zeroes.
+      idx	Index of element wanted. 
+*/
+MY_GLOBAL_API int my_array_get(my_array* __array, void* __element, unsigned int __idx)
+{
+    if(__idx >= __array->elements)
+	{
+	    memset(__element, 0, __array->size);
+		return 1;
+	}
+	memcpy(__element, __array->buffer + (size_t) __idx * __array->size, (size_t) __array->size);
+	return 0;
+}
+
+
+/*
+  Delete element by given index
+
+  SYNOPSIS
+    my_array_delete()
+      array
+      idx        Index of element to be deleted
+*/
+MY_GLOBAL_API void my_array_delete(my_array* __array, unsigned int __idx)
+{
+    unsigned char* ptr = __array->buffer + (size_t) __array->size * __idx;
+	__array->elements--;
+	memmove(ptr, ptr + __array->size, (size_t) (__array->elements - __idx) * __array->size);
+}
+
+
+/*
+  Delete a range of elements
+
+  SYNOPSIS
+    my_array_erase()
+      array
+      idx	Index of the first element to delete
+      count	Number of elements to delete, cut at the end of the array
+*/
+
+MY_GLOBAL_API void my_array_erase(my_array* __array, unsigned int __idx, unsigned int __count)
+{
+    unsigned char* ptr;
+
+    if (__idx >= __array->elements)
+        return;
+    __count = MIN(__count, __array->elements - __idx);
+    ptr = __array->buffer + (size_t) __idx * __array->size;
+    memmove(ptr, ptr + (size_t) __count * __array->size,
+            (size_t) (__array->elements - __idx - __count) * __array->size);
+    __array->elements -= __count;
+}
+
+
+/*
+  Delete all elements matching a predicate
+
+  SYNOPSIS
+    my_array_remove_if()
+      array
+      pred	Returns non zero for elements to delete
+      arg	Passed to pred
+
+  DESCRIPTION
+    The array is compacted in one pass: runs of kept elements are moved
+    down with one memmove each, so the cost is linear in the number of
+    elements whatever the number deleted. The order of kept elements
+    is preserved.
+
+  RETURN VALUE
+    Number of deleted elements
+*/
+
+MY_GLOBAL_API unsigned int my_array_remove_if(my_array* __array, my_array_pred __pred, void* __arg)
+{
+    size_t size = __array->size;
+    unsigned int idx, start, to = 0;
+
+    for (idx = 0; idx < __array->elements; )
+    {
+        if ((*__pred)(__array->buffer + idx * size, __arg))
+        {
+            idx++;
+            continue;
+        }
+        /* Move the run of kept elements starting at idx */
+        for (start = idx++; idx < __array->elements &&
+             !(*__pred)(__array->buffer + idx * size, __arg); idx++)
+            ;
+        if (to != start)
+            memmove(__array->buffer + to * size, __array->buffer + start * size,
+                    (idx - start) * size);
+        to += idx - start;
+    }
+    idx = __array->elements - to;
+    __array->elements = to;
+    return idx;
+}
+
+
+/*
+  Sort the elements of array
+
+  SYNOPSIS
+    my_array_sort()
+      array
+      cmp	Compare function
+      arg	First argument of cmp
+      threads	Number of threads, 0 for one per CPU, 1 to sort in the
+                calling thread
 
   NOTES
-   Any new allocated element are NOT initialized
+    With more than one thread, big arrays are sorted with
+    my_qsort_parallel(), which needs a scratch buffer as big as the
+    array.
 
   RETURN VALUE
     FALSE	Ok
-    TRUE	Allocation of new memory failed
+    TRUE	Out of memory
 */
 
-static int my_array_allocate(my_array* __array, unsigned int __number)
+MY_GLOBAL_API int my_array_sort(my_array* __array, qsort_cmp2 __cmp, const void* __arg,
+                                 unsigned int __threads)
+{
+    if (__threads == 1)
+        return my_qsort2(__array->buffer, __array->elements, __array->size, __cmp, __arg);
+    return my_qsort_parallel(__array->buffer, __array->elements, __array->size,
+                             __cmp, __arg, __threads);
+}
+
+
+/*
+  Sort the elements of array on a key, without comparator
+
+  SYNOPSIS
+    my_array_radix_sort()
+      array
+      offset	Offset of the key in an element
+      length	Length of the key
+      flags	MY_RADIX_SIGNED, MY_RADIX_DESC for integer keys
+                MY_RADIX_BYTES to compare keys of 4 or 8 bytes like memcmp()
+
+  NOTES
+    Keys of 4 or 8 bytes are integers in host byte order, sorted with
+    my_radix_sort_u32()/my_radix_sort_u64(). Other keys are byte
+    strings sorted with my_radix_sort_bytes(). A scratch buffer as big
+    as the array is allocated.
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory
+*/
+
+MY_GLOBAL_API int my_array_radix_sort(my_array* __array, size_t __offset, size_t __length,
+                                       unsigned int __flags)
 {
-    unsigned int size;
-	unsigned char* buffer;
-    if (__number >= __array->number)
+    if (!(__flags & MY_RADIX_BYTES))
     {
-	    size = (__number + __array->increment)/__array->increment;
-        size *= __array->increment;
-        if (__array->buffer == (unsigned char*)(__array + 1))
-        {    
-            if(!(buffer= (unsigned char*) my_malloc(size * __array->size)))
-                return 1;
-            memcpy(buffer, __array->buffer, __array->elements * __array->size);
-        } else{		
-		    if (!(buffer = (unsigned char*) my_realloc(__array->buffer, size * __array->size)))
-                return 1;
-		} 
-		__array->buffer = buffer;
-        __array->number = size;
+        if (__length == 4)
+            return my_radix_sort_u32(__array->buffer, __array->elements, __array->size,
+                                     __offset, __flags, NULL);
+        if (__length == 8)
+            return my_radix_sort_u64(__array->buffer, __array->elements, __array->size,
+                                     __offset, __flags, NULL);
     }
-    return 0;
+    return my_radix_sort_bytes(__array->buffer, __array->elements, __array->size,
+                               __offset, __length, NULL);
 }
 
 
 /*
-  Get an element from array by given index
+  Find the first element whose integer field compares to a value
 
   SYNOPSIS
-    get_dynamic()
-      array	
-      uchar*	Element to be returned. If idx > elements contain zeroes.
-      idx	Index of element wanted. 
+    my_array_find()
+      array
+      offset	Offset of the field in an element
+      width	Size of the field: 1, 2, 4 or 8 bytes
+      op	MY_SCAN_EQ ... MY_SCAN_GE, or'ed with MY_SCAN_UNSIGNED
+      value	Value to compare the field to
+
+  NOTES
+    The scan runs on the buffer with the vector kernels of my_scan.h,
+    no element is copied.
+
+  RETURN VALUE
+    Index of the element, elements if none matches
 */
-MY_GLOBAL_API int my_array_get(my_array* __array, void* __element, unsigned int __idx)
+
+MY_GLOBAL_API unsigned int my_array_find(my_array* __array, unsigned int __offset, unsigned int __width,
+                                          unsigned int __op, unsigned long long __value)
 {
-    if(__idx >= __array->elements)
-	{
-	    memset(__element, 0, __array->size);
-		return 1;
-	}
-	memcpy(__element, __array->buffer + __idx * __array->size, (size_t) __array->size);
-	return 0;
+    return (unsigned int) my_scan_find(__array->buffer + __offset, __array->elements, __array->size,
+                                       __width, __op, __value);
 }
 
 
 /*
-  Delete element by given index
+  Count the elements whose field compares to a value, see my_array_find()
+*/
+
+MY_GLOBAL_API unsigned int my_array_count(my_array* __array, unsigned int __offset, unsigned int __width,
+                                           unsigned int __op, unsigned long long __value)
+{
+    return (unsigned int) my_scan_count(__array->buffer + __offset, __array->elements, __array->size,
+                                        __width, __op, __value);
+}
+
+
+/*
+  Append the indexes of the elements whose field compares to a value
 
   SYNOPSIS
-    delete_dynamic_element()
-      array
-      idx        Index of element to be deleted
+    my_array_filter()
+      rows	Array of unsigned int receiving the indexes
+      Other arguments as for my_array_find()
+
+  NOTES
+    rows is first reserved for the worst case, every element matching.
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory, or rows does not hold unsigned int
 */
-MY_GLOBAL_API void my_array_delete(my_array* __array, unsigned int __idx)
+
+MY_GLOBAL_API int my_array_filter(my_array* __array, unsigned int __offset, unsigned int __width,
+                                   unsigned int __op, unsigned long long __value, my_array* __rows)
 {
-    char* ptr = (char*)__array->buffer + __array->size * __idx;
-	__array->elements--;
-	memmove(ptr, ptr + __array->size, (__array->elements - idx) * __array->size);
+    if (__rows->size != sizeof(unsigned int) ||
+        __array->elements > UINT_MAX - __rows->elements ||
+        my_array_reserve(__rows, __rows->elements + __array->elements))
+        return 1;
+    __rows->elements += (unsigned int)
+        my_scan_filter(__array->buffer + __offset, __array->elements, __array->size, __width, __op,
+                       __value, (unsigned int*) __rows->buffer + __rows->elements);
+    return 0;
 }
 
 
@@ -289,19 +656,29 @@ MY_GLOBAL_API void my_array_delete(my_array* __array, unsigned int __idx)
   Free unused memory
 
   SYNOPSIS
-    freeze_size()
+    my_array_free()
       array	Array to be freed
 
+  NOTES
+    The buffer is only shrunk when less than MY_ARRAY_SHRINK_PERCENT of it
+    is used, and then to the exact number of elements. The threshold is
+    below the growth factor, so an array alternating between appends and
+    my_array_free() does not reallocate every time.
+
+    Buffers big enough to be mapped by my_malloc() are not reallocated:
+    the pages past the last element are given back to the system with
+    my_malloc_trim(), which keeps the buffer in place and its capacity.
 */
 MY_GLOBAL_API void my_array_free(my_array* __array)
 {
     unsigned int elements = MAX(__array->elements, 1);
-	if(__array->buffer == (unsigned char*)(__array + 1))
-	    return;
-	if(__array->buffer && __array->number != elements)
-	{
-	    __array->buffer = (unsigned char*) my_realloc(__array->buffer, elements * __array->size);
-		__array->number = elements;
-	}
-}
 
+    if ((__array->flags & MY_ARRAY_INIT_BUFFER_USED) || !__array->buffer)
+        return;
+    if ((unsigned long long) elements * 100 >=
+        (unsigned long long) __array->number * MY_ARRAY_SHRINK_PERCENT)
+        return;
+    if (my_malloc_trim(__array->buffer, (size_t) elements * __array->size))
+        return;
+    array_resize(__array, elements);
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Columnar array.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  my_col_array stores the same rows as a my_array of records, but each
+  field of the record layout lives in its own column. All columns have
+  the same capacity and grow together, following my_array_grow(), so a
+  row index is valid in every column.
+
+  Columns are allocated on MY_COL_ARRAY_ALIGN bytes and stay aligned
+  when they grow, so column scans can use aligned vector loads.
+*/
+
+#include <limits.h>
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_col_array.h"
+
+
+/*
+  Initiate columnar array
+
+  SYNOPSIS
+    my_col_array_init()
+      fields		Offset and size of each field in a record
+      field_count	Number of fields
+      record_size	Size of a record, as passed to append, get and set
+      number		Number of rows to allocate
+
+  RETURN VALUE
+    pointer	Ok, free it with my_col_array_uninit() and my_free()
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API my_col_array* my_col_array_init(const my_col_field* __fields, unsigned int __field_count,
+                                              unsigned int __record_size, unsigned int __number)
+{
+    my_col_array* array;
+
+    if (!(array = my_malloc_padded_ex(sizeof(my_col_array), MY_MEM_ARRAY)))
+        return NULL;
+    memset(array, 0, sizeof(my_col_array));
+    if (!(array->columns = (unsigned char**) my_calloc_ex(__field_count, sizeof(unsigned char*), MY_MEM_ARRAY)) ||
+        !(array->fields = (my_col_field*) my_malloc_ex(__field_count * sizeof(my_col_field), MY_MEM_ARRAY)))
+    {
+        my_free(array->columns);
+        my_free(array);
+        return NULL;
+    }
+    memcpy(array->fields, __fields, __field_count * sizeof(my_col_field));
+    array->field_count = __field_count;
+    array->record_size = __record_size;
+    array->growth.policy = MY_ARRAY_GROW_GEOMETRIC;
+    array->growth.factor = MY_ARRAY_GROW_FACTOR;
+    array->growth.increment = ARRAY_INIT_INCREMENT;
+    array->growth.max_increment = 0;
+    if (my_col_array_reserve(array, MAX(__number, ARRAY_INIT_NUMBER)))
+    {
+        my_col_array_uninit(array);
+        my_free(array);
+        return NULL;
+    }
+    return array;
+}
+
+
+MY_GLOBAL_API void my_col_array_uninit(my_col_array* __array)
+{
+    unsigned int field;
+
+    if (__array->columns)
+    {
+        for (field = 0; field < __array->field_count; field++)
+            my_free(__array->columns[field]);
+        my_free(__array->columns);
+    }
+    my_free(__array->fields);
+    __array->columns = NULL;
+    __array->fields = NULL;
+    __array->elements = 0;
+    __array->number = 0;
+}
+
+
+/*
+  Resize every column to exactly number rows
+
+  NOTES
+    Aligned blocks are always copied on realloc, so all the new columns
+    are allocated before any old one is freed: on failure the array is
+    unchanged.
+*/
+
+static int col_array_resize(my_col_array* __array, unsigned int __number)
+{
+    unsigned int field;
+    unsigned char** columns;
+    unsigned int rows = MIN(__array->elements, __number);
+
+    if (!(columns = (unsigned char**) my_calloc_ex(__array->field_count, sizeof(unsigned char*), MY_MEM_ARRAY)))
+        return 1;
+    for (field = 0; field < __array->field_count; field++)
+    {
+        size_t length = MAX((size_t) __number * __array->fields[field].size, 1);
+
+        if (!(columns[field] = (unsigned char*) my_malloc_aligned_ex(length, MY_COL_ARRAY_ALIGN, MY_MEM_ARRAY)))
+        {
+            while (field--)
+                my_free(columns[field]);
+            my_free(columns);
+            return 1;
+        }
+        if (__array->columns[field])
+            memcpy(columns[field], __array->columns[field], (size_t) rows * __array->fields[field].size);
+    }
+    for (field = 0; field < __array->field_count; field++)
+        my_free(__array->columns[field]);
+    my_free(__array->columns);
+    __array->columns = columns;
+    __array->number = __number;
+    return 0;
+}
+
+
+/*
+  Make room for a number of rows in every column
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory
+*/
+
+MY_GLOBAL_API int my_col_array_reserve(my_col_array* __array, unsigned int __number)
+{
+    if (__number <= __array->number)
+        return 0;
+    return col_array_resize(__array, __number);
+}
+
+
+/* Grow following the growth policy, to hold at least number rows */
+
+static int col_array_allocate(my_col_array* __array, unsigned int __number)
+{
+    if (__number <= __array->number)
+        return 0;
+    return col_array_resize(__array, my_array_grow(&__array->growth, __array->number, __number));
+}
+
+
+/*
+  Append records
+
+  SYNOPSIS
+    my_col_array_append()
+      array
+      records	count records of record_size bytes
+      count	Number of records
+
+  DESCRIPTION
+    The columns grow once, then the records are split column by column,
+    so every column is written sequentially.
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory, the array is unchanged
+*/
+
+MY_GLOBAL_API int my_col_array_append(my_col_array* __array, const void* __records, unsigned int __count)
+{
+    const unsigned char* record;
+    unsigned char* to;
+    unsigned int field, idx, size, offset;
+
+    if (__count > UINT_MAX - __array->elements ||
+        col_array_allocate(__array, __array->elements + __count))
+        return 1;
+    for (field = 0; field < __array->field_count; field++)
+    {
+        size = __array->fields[field].size;
+        offset = __array->fields[field].offset;
+        to = __array->columns[field] + (size_t) __array->elements * size;
+        record = (const unsigned char*) __records + offset;
+        for (idx = 0; idx < __count; idx++, to += size, record += __array->record_size)
+            memcpy(to, record, size);
+    }
+    __array->elements += __count;
+    return 0;
+}
+
+
+/*
+  Assemble a row into a record
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	idx out of range, the record is untouched
+*/
+
+MY_GLOBAL_API int my_col_array_get(my_col_array* __array, void* __record, unsigned int __idx)
+{
+    unsigned int field, size;
+
+    if (__idx >= __array->elements)
+        return 1;
+    for (field = 0; field < __array->field_count; field++)
+    {
+        size = __array->fields[field].size;
+        memcpy((unsigned char*) __record + __array->fields[field].offset,
+               __array->columns[field] + (size_t) __idx * size, size);
+    }
+    return 0;
+}
+
+
+/*
+  Replace a row, rows between the last one and idx are zeroed
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory
+*/
+
+MY_GLOBAL_API int my_col_array_set(my_col_array* __array, const void* __record, unsigned int __idx)
+{
+    unsigned int field, size;
+
+    if (__idx >= __array->elements)
+    {
+        if (__idx == UINT_MAX || col_array_allocate(__array, __idx + 1))
+            return 1;
+        for (field = 0; field < __array->field_count; field++)
+        {
+            size = __array->fields[field].size;
+            memset(__array->columns[field] + (size_t) __array->elements * size, 0,
+                   (size_t) (__idx - __array->elements) * size);
+        }
+        __array->elements = __idx + 1;
+    }
+    for (field = 0; field < __array->field_count; field++)
+    {
+        size = __array->fields[field].size;
+        memcpy(__array->columns[field] + (size_t) __idx * size,
+               (const unsigned char*) __record + __array->fields[field].offset, size);
+    }
+    return 0;
+}
+
+
+/*
+  Copy the values of one field for a list of rows
+
+  SYNOPSIS
+    my_col_array_gather()
+      array
+      field	Field to read
+      rows	Row indexes, below elements
+      count	Number of rows
+      to	Receives count values, packed
+
+  NOTES
+    Used to materialize a field for the rows selected by a scan of
+    another column.
+*/
+
+MY_GLOBAL_API void my_col_array_gather(my_col_array* __array, unsigned int __field,
+                                       const unsigned int* __rows, unsigned int __count, void* __to)
+{
+    const unsigned char* column = __array->columns[__field];
+    unsigned char* to = (unsigned char*) __to;
+    unsigned int size = __array->fields[__field].size;
+    unsigned int idx;
+
+    switch (size) {
+    case 4:
+        for (idx = 0; idx < __count; idx++)
+            memcpy(to + idx * 4, column + (size_t) __rows[idx] * 4, 4);
+        break;
+    case 8:
+        for (idx = 0; idx < __count; idx++)
+            memcpy(to + idx * 8, column + (size_t) __rows[idx] * 8, 8);
+        break;
+    default:
+        for (idx = 0; idx < __count; idx++)
+            memcpy(to + (size_t) idx * size, column + (size_t) __rows[idx] * size, size);
+    }
+}
+
+
+/*
+  Free unused memory, with the hysteresis of my_array_free()
+
+  RETURN VALUE
+    FALSE	Ok, or nothing to free
+    TRUE	Out of memory, the array is unchanged
+*/
+
+MY_GLOBAL_API int my_col_array_free(my_col_array* __array)
+{
+    unsigned int elements = MAX(__array->elements, 1);
+
+    if ((unsigned long long) elements * 100 >=
+        (unsigned long long) __array->number * MY_ARRAY_SHRINK_PERCENT)
+        return 0;
+    return col_array_resize(__array, elements);
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Double ended queue.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  my_deque replaces my_array used as a FIFO: my_array_delete(array, 0)
+  moves every remaining element, my_deque_pop_front() only advances
+  head. The buffer grows with the policy of my_array; growing copies
+  the elements once into the new buffer in order, so the ring is
+  unwrapped and head is 0 again.
+
+  The span functions give direct access to the contiguous elements at
+  the front and the contiguous free slots at the back, for callers that
+  read or write many elements at once (read(), write(), memcpy()).
+*/
+
+#include <limits.h>
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_deque.h"
+
+#define DEQUE_SLOT(deque, slot) ((deque)->buffer + (size_t) (slot) * (deque)->size)
+
+
+/*
+  Initiate a deque
+
+  SYNOPSIS
+    my_deque_init()
+      number		Number of initial slots, 0 for increment
+      increment		Smallest growth in elements, 0 for default
+      size		Size of element
+
+  RETURN VALUE
+    pointer	Ok, free it with my_deque_uninit() and my_free()
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API my_deque* my_deque_init(unsigned int __number, unsigned int __increment, unsigned int __size)
+{
+    my_deque* deque;
+
+    if (!(deque = my_malloc_padded_ex(sizeof(my_deque), MY_MEM_ARRAY)))
+        return NULL;
+    memset(deque, 0, sizeof(my_deque));
+    if (!__increment)
+        __increment = MAX((ARRAT_BLOCK_SIZE - MALLOC_OVERHEAD)/__size, ARRAY_INIT_INCREMENT);
+    if (!__number)
+        __number = __increment;
+    deque->size = __size;
+    deque->growth.policy = MY_ARRAY_GROW_GEOMETRIC;
+    deque->growth.factor = MY_ARRAY_GROW_FACTOR;
+    deque->growth.increment = __increment;
+    deque->growth.max_increment = 0;
+    if (!(deque->buffer = (unsigned char*) my_malloc_ex((size_t) __size * __number, MY_MEM_ARRAY)))
+    {
+        my_free(deque);
+        return NULL;
+    }
+    deque->number = __number;
+    return deque;
+}
+
+
+/*
+  Free the buffer of the deque
+
+  SYNOPSIS
+    my_deque_uninit()
+      deque	Deque to be deleted
+*/
+
+MY_GLOBAL_API void my_deque_uninit(my_deque* __deque)
+{
+    my_free(__deque->buffer);
+    __deque->buffer = NULL;
+    __deque->head = 0;
+    __deque->elements = 0;
+    __deque->number = 0;
+}
+
+
+/*
+  Select how the deque grows, see my_array_set_growth()
+*/
+
+MY_GLOBAL_API void my_deque_set_growth(my_deque* __deque, unsigned int __policy,
+                                       unsigned int __factor, unsigned int __max_increment)
+{
+    __deque->growth.policy = __policy;
+    __deque->growth.factor = __factor > 100 ? __factor : MY_ARRAY_GROW_FACTOR;
+    __deque->growth.max_increment = __max_increment;
+}
+
+
+/*
+  Move the elements to a new buffer of number slots, unwrapped
+*/
+
+static int deque_resize(my_deque* __deque, unsigned int __number)
+{
+    unsigned char* buffer;
+    unsigned int first = MIN(__deque->elements, __deque->number - __deque->head);
+
+    if (!__deque->head && __deque->elements)
+    {
+        /* Not wrapped, realloc may extend the buffer in place */
+        if (!(buffer = (unsigned char*) my_realloc_ex(__deque->buffer, (size_t) __number * __deque->size,
+                                                      MY_MEM_ARRAY)))
+            return 1;
+    }
+    else
+    {
+        if (!(buffer = (unsigned char*) my_malloc_ex((size_t) __number * __deque->size, MY_MEM_ARRAY)))
+            return 1;
+        memcpy(buffer, DEQUE_SLOT(__deque, __deque->head), (size_t) first * __deque->size);
+        memcpy(buffer + (size_t) first * __deque->size, __deque->buffer,
+               (size_t) (__deque->elements - first) * __deque->size);
+        my_free(__deque->buffer);
+    }
+    __deque->buffer = buffer;
+    __deque->head = 0;
+    __deque->number = __number;
+    return 0;
+}
+
+
+/*
+  Make room for a number of elements
+
+  SYNOPSIS
+    my_deque_reserve()
+      deque
+      number	Number of elements the deque must be able to hold
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory
+*/
+
+MY_GLOBAL_API int my_deque_reserve(my_deque* __deque, unsigned int __number)
+{
+    if (__number <= __deque->number)
+        return 0;
+    return deque_resize(__deque, __number);
+}
+
+
+/*
+  Ensure room for count more elements, growing with the policy
+*/
+
+static int deque_allocate(my_deque* __deque, unsigned int __count)
+{
+    if (__count > UINT_MAX - __deque->elements)
+        return 1;
+    if (__deque->elements + __count <= __deque->number)
+        return 0;
+    return deque_resize(__deque, my_array_grow(&__deque->growth, __deque->number,
+                                               __deque->elements + __count));
+}
+
+
+MY_GLOBAL_API int my_deque_push_back(my_deque* __deque, const void* __element)
+{
+    if (deque_allocate(__deque, 1))
+        return 1;
+    memcpy(my_deque_element(__deque, __deque->elements), __element, __deque->size);
+    __deque->elements++;
+    return 0;
+}
+
+
+MY_GLOBAL_API int my_deque_push_front(my_deque* __deque, const void* __element)
+{
+    if (deque_allocate(__deque, 1))
+        return 1;
+    __deque->head = __deque->head ? __deque->head - 1 : __deque->number - 1;
+    __deque->elements++;
+    memcpy(DEQUE_SLOT(__deque, __deque->head), __element, __deque->size);
+    return 0;
+}
+
+
+/*
+  Remove the first element
+
+  RETURN VALUE
+    pointer	The removed element, valid until the next insertion
+    NULL	The deque is empty
+*/
+
+MY_GLOBAL_API void* my_deque_pop_front(my_deque* __deque)
+{
+    unsigned char* element;
+
+    if (!__deque->elements)
+        return NULL;
+    element = DEQUE_SLOT(__deque, __deque->head);
+    if (++__deque->head == __deque->number)
+        __deque->head = 0;
+    __deque->elements--;
+    return element;
+}
+
+
+MY_GLOBAL_API void* my_deque_pop_back(my_deque* __deque)
+{
+    if (!__deque->elements)
+        return NULL;
+    return my_deque_element(__deque, --__deque->elements);
+}
+
+
+MY_GLOBAL_API void* my_deque_front(my_deque* __deque)
+{
+    return __deque->elements ? DEQUE_SLOT(__deque, __deque->head) : NULL;
+}
+
+
+MY_GLOBAL_API void* my_deque_back(my_deque* __deque)
+{
+    return __deque->elements ? my_deque_element(__deque, __deque->elements - 1) : NULL;
+}
+
+
+/*
+  Copy element idx out of the deque
+
+  RETURN VALUE
+    0	Ok
+    1	idx is not below elements
+*/
+
+MY_GLOBAL_API int my_deque_get(my_deque* __deque, void* __element, unsigned int __idx)
+{
+    if (__idx >= __deque->elements)
+        return 1;
+    memcpy(__element, my_deque_element(__deque, __idx), __deque->size);
+    return 0;
+}
+
+
+MY_GLOBAL_API int my_deque_set(my_deque* __deque, const void* __element, unsigned int __idx)
+{
+    if (__idx >= __deque->elements)
+        return 1;
+    memcpy(my_deque_element(__deque, __idx), __element, __deque->size);
+    return 0;
+}
+
+
+/*
+  Append count elements at the back
+
+  DESCRIPTION
+    Grows the deque at most once and copies the elements with at most
+    two memcpy().
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory, nothing was appended
+*/
+
+MY_GLOBAL_API int my_deque_push_back_many(my_deque* __deque, const void* __elements, unsigned int __count)
+{
+    unsigned int slot, first;
+
+    if (!__count)
+        return 0;
+    if (deque_allocate(__deque, __count))
+        return 1;
+    slot = my_deque_slot(__deque, __deque->elements);
+    first = MIN(__count, __deque->number - slot);
+    memcpy(DEQUE_SLOT(__deque, slot), __elements, (size_t) first * __deque->size);
+    memcpy(__deque->buffer, (const unsigned char*) __elements + (size_t) first * __deque->size,
+           (size_t) (__count - first) * __deque->size);
+    __deque->elements += __count;
+    return 0;
+}
+
+
+/*
+  Remove up to count elements from the front
+
+  SYNOPSIS
+    my_deque_pop_front_many()
+      deque
+      to	Where the removed elements are copied, or NULL to drop them
+      count	Largest number of elements to remove
+
+  RETURN VALUE
+    Number of elements removed
+*/
+
+MY_GLOBAL_API unsigned int my_deque_pop_front_many(my_deque* __deque, void* __to, unsigned int __count)
+{
+    unsigned int first;
+
+    __count = MIN(__count, __deque->elements);
+    if (__to)
+    {
+        first = MIN(__count, __deque->number - __deque->head);
+        memcpy(__to, DEQUE_SLOT(__deque, __deque->head), (size_t) first * __deque->size);
+        memcpy((unsigned char*) __to + (size_t) first * __deque->size, __deque->buffer,
+               (size_t) (__count - first) * __deque->size);
+    }
+    my_deque_consume_front(__deque, __count);
+    return __count;
+}
+
+
+/*
+  Contiguous elements at the front
+
+  SYNOPSIS
+    my_deque_front_span()
+      deque
+      count	Set to the number of contiguous elements from the front
+
+  DESCRIPTION
+    The elements are read in place and released with
+    my_deque_consume_front(). When the ring wraps, a second call after
+    consuming the first span returns the rest.
+
+  RETURN VALUE
+    pointer	The first element
+    NULL	The deque is empty, count is 0
+*/
+
+MY_GLOBAL_API void* my_deque_front_span(my_deque* __deque, unsigned int* __count)
+{
+    *__count = MIN(__deque->elements, __deque->number - __deque->head);
+    return *__count ? DEQUE_SLOT(__deque, __deque->head) : NULL;
+}
+
+
+/*
+  Remove count elements from the front, count is at most elements
+*/
+
+MY_GLOBAL_API void my_deque_consume_front(my_deque* __deque, unsigned int __count)
+{
+    __deque->elements -= __count;
+    if (!__deque->elements)
+        __deque->head = 0;   /* Keep the free slots contiguous */
+    else
+        __deque->head = my_deque_slot(__deque, __count);
+}
+
+
+/*
+  Contiguous free slots at the back
+
+  SYNOPSIS
+    my_deque_back_span()
+      deque
+      wanted	Number of elements to be written, the deque grows to
+                hold them
+      count	Set to the number of contiguous free slots, at least 1
+                but maybe less than wanted when the free slots wrap
+
+  DESCRIPTION
+    The caller writes up to count elements at the returned address and
+    adds them to the deque with my_deque_commit_back().
+
+  RETURN VALUE
+    pointer	First free slot
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API void* my_deque_back_span(my_deque* __deque, unsigned int __wanted, unsigned int* __count)
+{
+    unsigned int slot;
+
+    *__count = 0;
+    if (deque_allocate(__deque, MAX(__wanted, 1)))
+        return NULL;
+    slot = my_deque_slot(__deque, __deque->elements);
+    if (slot >= __deque->head && __deque->elements < __deque->number)
+        *__count = __deque->number - slot;                  /* Free up to the end */
+    else
+        *__count = __deque->number - __deque->elements;     /* Free up to head */
+    return DEQUE_SLOT(__deque, slot);
+}
+
+
+/*
+  Add count elements written in the span of my_deque_back_span()
+*/
+
+MY_GLOBAL_API void my_deque_commit_back(my_deque* __deque, unsigned int __count)
+{
+    __deque->elements += __count;
+}
@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * External merge sort.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  Records are collected in a buffer of the memory budget. When it is
+  full, it is sorted, by several threads with my_qsort_parallel(), and
+  written as one run at the end of a temporary file, in one large
+  sequential write. If everything fits in the budget, nothing is
+  written and the output comes from the buffer.
+
+  At the end the runs are merged with my_merge, each read through its
+  own read-ahead buffer, a share of the budget. Runs of at least
+  MY_EXTSORT_MIN_BUFFER bytes each fit in the budget; when there are
+  more runs than that, groups of them are first merged into longer runs
+  appended to the file, so the file may grow to about twice the input.
+
+  The temporary file is removed as soon as it is created and disappears
+  when it is closed, also if the process dies.
+
+  A sort with threads > 1 splits the budget in two, the sorting threads
+  need a scratch buffer as big as the run.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_extsort.h"
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+#define EXTSORT_RUN(sort, idx) my_array_element((sort)->runs, idx, my_extsort_run*)
+
+
+/*
+  Create an external sort
+
+  SYNOPSIS
+    my_extsort_init()
+      size	Size of a record
+      cmp	Compare function of the records
+      arg	First argument of cmp
+      budget	Bytes of memory to use, 0 for MY_EXTSORT_BUDGET
+      threads	Threads sorting each run, 0 or 1 for the calling thread
+      tmpdir	Directory of the temporary file, NULL for $TMPDIR or /tmp
+
+  RETURN VALUE
+    pointer	Ok, free it with my_extsort_uninit() and my_free()
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API my_extsort* my_extsort_init(size_t __size, qsort_cmp2 __cmp, const void* __arg,
+                                          size_t __budget, unsigned int __threads, const char* __tmpdir)
+{
+    my_extsort* sort;
+
+    if (!(sort = my_malloc_padded_ex(sizeof(my_extsort), MY_MEM_ARRAY)))
+        return NULL;
+    memset(sort, 0, sizeof(my_extsort));
+    sort->size = __size;
+    sort->cmp = __cmp;
+    sort->cmp_arg = __arg;
+    sort->budget = MAX(__budget ? __budget : MY_EXTSORT_BUDGET, 2 * MY_EXTSORT_MIN_BUFFER);
+    sort->threads = MAX(__threads, 1);
+    sort->fd = -1;
+    sort->capacity = MAX((sort->threads > 1 ? sort->budget / 2 : sort->budget) / __size, 1);
+    if (__tmpdir)
+    {
+        if (!(sort->tmpdir = (char*) my_malloc_ex(strlen(__tmpdir) + 1, MY_MEM_ARRAY)))
+            goto err;
+        strcpy(sort->tmpdir, __tmpdir);
+    }
+    if (!(sort->buffer = (unsigned char*) my_malloc_ex(sort->capacity * __size, MY_MEM_ARRAY)) ||
+        !(sort->runs = my_array_init(NULL, 0, 0, sizeof(my_extsort_run))))
+        goto err;
+    return sort;
+
+err:
+    my_free(sort->buffer);
+    my_free(sort->tmpdir);
+    my_free(sort);
+    return NULL;
+}
+
+
+/*
+  Free the buffers and remove the temporary file
+*/
+
+MY_GLOBAL_API void my_extsort_uninit(my_extsort* __sort)
+{
+    if (__sort->merge)
+    {
+        my_merge_uninit(__sort->merge);
+        my_free(__sort->merge);
+        __sort->merge = NULL;
+    }
+    if (__sort->runs)
+    {
+        my_array_uninit(__sort->runs);
+        my_free(__sort->runs);
+        __sort->runs = NULL;
+    }
+    if (__sort->fd >= 0)
+    {
+#if defined(_WIN32)
+        _close(__sort->fd);
+#else
+        close(__sort->fd);
+#endif
+        __sort->fd = -1;
+    }
+    my_free(__sort->buffer);
+    my_free(__sort->tmpdir);
+    __sort->buffer = NULL;
+    __sort->tmpdir = NULL;
+}
+
+
+/*
+  Create the temporary file, removed at once
+*/
+
+static bool extsort_open(my_extsort* __sort)
+{
+    const char* dir = __sort->tmpdir;
+#if defined(_WIN32)
+    char* path;
+
+    if (!(path = _tempnam(dir, "my_extsort")))
+        return FALSE;
+    __sort->fd = _open(path, _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY | _O_TEMPORARY,
+                       _S_IREAD | _S_IWRITE);
+    free(path);
+#else
+    static const char name[] = "/my_extsort_XXXXXX";
+    char* path;
+
+    if (!dir && !(dir = getenv("TMPDIR")))
+        dir = "/tmp";
+    if (!(path = (char*) my_malloc_ex(strlen(dir) + sizeof(name), MY_MEM_ARRAY)))
+        return FALSE;
+    strcpy(path, dir);
+    strcat(path, name);
+    if ((__sort->fd = mkstemp(path)) >= 0)
+        unlink(path);
+    my_free(path);
+#endif
+    return __sort->fd >= 0;
+}
+
+
+/*
+  Write length bytes at offset of the temporary file
+*/
+
+static bool extsort_pwrite(int __fd, const unsigned char* __buffer, size_t __length,
+                           unsigned long long __offset)
+{
+#if defined(_WIN32)
+    int done;
+
+    if (_lseeki64(__fd, (__int64) __offset, SEEK_SET) < 0)
+        return FALSE;
+    for (; __length; __length -= (size_t) done, __buffer += done)
+    {
+        if ((done = _write(__fd, __buffer, (unsigned int) MIN(__length, 1U << 30))) <= 0)
+            return FALSE;
+    }
+#else
+    ssize_t done;
+
+    for (; __length; __length -= (size_t) done, __buffer += done, __offset += (size_t) done)
+    {
+        if ((done = pwrite(__fd, __buffer, __length, (off_t) __offset)) <= 0)
+            return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+
+/*
+  Append records as a new run at the end of the temporary file
+*/
+
+static bool extsort_append_run(my_extsort* __sort, const unsigned char* __records, size_t __count)
+{
+    my_extsort_run run;
+
+    if (__sort->fd < 0 && !extsort_open(__sort))
+        return FALSE;
+    run.offset = __sort->file_size;
+    run.count = __count;
+    if (!extsort_pwrite(__sort->fd, __records, __count * __sort->size, run.offset) ||
+        my_array_insert(__sort->runs, &run))
+        return FALSE;
+    __sort->file_size += __count * __sort->size;
+    return TRUE;
+}
+
+
+static bool extsort_sort_buffer(my_extsort* __sort)
+{
+    if (__sort->threads > 1)
+        return !my_qsort_parallel(__sort->buffer, __sort->count, __sort->size, __sort->cmp,
+                                  __sort->cmp_arg, __sort->threads);
+    return !my_qsort2(__sort->buffer, __sort->count, __sort->size, __sort->cmp, __sort->cmp_arg);
+}
+
+
+/*
+  Sort the buffer and write it as a run
+*/
+
+static int extsort_spill(my_extsort* __sort)
+{
+    if (!extsort_sort_buffer(__sort) || !extsort_append_run(__sort, __sort->buffer, __sort->count))
+        return __sort->error = 1;
+    __sort->count = 0;
+    return 0;
+}
+
+
+/*
+  Add records to sort
+
+  DESCRIPTION
+    The records are copied; a run is sorted and written each time the
+    budget is full.
+
+  RETURN VALUE
+    0	Ok
+    1	Error writing the temporary file or out of memory, or the sort
+        is finished
+*/
+
+MY_GLOBAL_API int my_extsort_add(my_extsort* __sort, const void* __records, size_t __count)
+{
+    const unsigned char* records = (const unsigned char*) __records;
+    size_t length;
+
+    if (__sort->error || __sort->finished)
+        return 1;
+    while (__count)
+    {
+        length = MIN(__count, __sort->capacity - __sort->count);
+        memcpy(__sort->buffer + __sort->count * __sort->size, records, length * __sort->size);
+        __sort->count += length;
+        __sort->records += length;
+        records += length * __sort->size;
+        __count -= length;
+        if (__sort->count == __sort->capacity && extsort_spill(__sort))
+            return 1;
+    }
+    return 0;
+}
+
+
+/*
+  Merge count runs from first into one run appended to the file
+*/
+
+static bool extsort_merge_runs(my_extsort* __sort, unsigned int __first, unsigned int __count)
+{
+    size_t buffer_size = MAX(__sort->budget / (__count + 1), MY_EXTSORT_MIN_BUFFER);
+    size_t records = MAX(buffer_size / __sort->size, 1);
+    unsigned char* out = NULL;
+    my_merge* merge;
+    my_extsort_run run;
+    unsigned int i;
+    size_t done;
+    bool error = TRUE;
+
+    if (!(merge = my_merge_init(__sort->size, __sort->cmp, __sort->cmp_arg, __count)))
+        return FALSE;
+    for (i = __first; i < __first + __count; i++)
+    {
+        if (my_merge_add_file(merge, __sort->fd, EXTSORT_RUN(__sort, i)->offset,
+                              EXTSORT_RUN(__sort, i)->count, buffer_size))
+            goto end;
+    }
+    if (!(out = (unsigned char*) my_malloc_ex(records * __sort->size, MY_MEM_ARRAY)))
+        goto end;
+    run.offset = __sort->file_size;
+    run.count = 0;
+    while ((done = my_merge_next_batch(merge, out, records)))
+    {
+        if (!extsort_pwrite(__sort->fd, out, done * __sort->size, __sort->file_size))
+            goto end;
+        __sort->file_size += done * __sort->size;
+        run.count += done;
+    }
+    error = my_merge_error(merge) || my_array_insert(__sort->runs, &run);
+
+end:
+    my_free(out);
+    my_merge_uninit(merge);
+    my_free(merge);
+    return !error;
+}
+
+
+/*
+  End the input and prepare the merge
+
+  DESCRIPTION
+    Called by the first my_extsort_next() or my_extsort_next_batch()
+    if not called before. Writes the last run and, if there are more
+    runs than the budget can buffer, merges them down to as many.
+
+  RETURN VALUE
+    0	Ok
+    1	Error writing or reading the temporary file, or out of memory
+*/
+
+MY_GLOBAL_API int my_extsort_finish(my_extsort* __sort)
+{
+    unsigned int first = 0, runs, fan_in;
+
+    if (__sort->error || __sort->finished)
+        return __sort->error;
+    __sort->finished = TRUE;
+    if (__sort->fd < 0)
+    {
+        /* Everything fits in memory */
+        if (!extsort_sort_buffer(__sort) ||
+            !(__sort->merge = my_merge_init(__sort->size, __sort->cmp, __sort->cmp_arg, 1)) ||
+            my_merge_add_memory(__sort->merge, __sort->buffer, __sort->count))
+            return __sort->error = 1;
+        return 0;
+    }
+    if (__sort->count && extsort_spill(__sort))
+        return 1;
+    my_free(__sort->buffer);    /* The budget goes to the read buffers */
+    __sort->buffer = NULL;
+
+    fan_in = (unsigned int) MAX(__sort->budget / MY_EXTSORT_MIN_BUFFER - 1, 2);
+    while ((runs = __sort->runs->elements - first) > fan_in + 1)
+    {
+        if (!extsort_merge_runs(__sort, first, fan_in))
+            return __sort->error = 1;
+        first += fan_in;
+    }
+    if (!(__sort->merge = my_merge_init(__sort->size, __sort->cmp, __sort->cmp_arg, runs)))
+        return __sort->error = 1;
+    for (; first < __sort->runs->elements; first++)
+    {
+        if (my_merge_add_file(__sort->merge, __sort->fd, EXTSORT_RUN(__sort, first)->offset,
+                              EXTSORT_RUN(__sort, first)->count,
+                              MAX(__sort->budget / runs, MY_EXTSORT_MIN_BUFFER)))
+            return __sort->error = 1;
+    }
+    return 0;
+}
+
+
+/*
+  Next record in sorted order
+
+  RETURN VALUE
+    pointer	The record, valid until the next call
+    NULL	All records were returned, or error, see my_extsort_error()
+*/
+
+MY_GLOBAL_API const void* my_extsort_next(my_extsort* __sort)
+{
+    const void* record;
+
+    if ((!__sort->finished && my_extsort_finish(__sort)) || __sort->error)
+        return NULL;
+    if (!(record = my_merge_next(__sort->merge)) && my_merge_error(__sort->merge))
+        __sort->error = 1;
+    return record;
+}
+
+
+/*
+  Copy the next count records in sorted order
+
+  RETURN VALUE
+    Number of records copied, less than count only at the end or on
+    error, see my_extsort_error()
+*/
+
+MY_GLOBAL_API size_t my_extsort_next_batch(my_extsort* __sort, void* __to, size_t __count)
+{
+    size_t done;
+
+    if ((!__sort->finished && my_extsort_finish(__sort)) || __sort->error)
+        return 0;
+    if ((done = my_merge_next_batch(__sort->merge, __to, __count)) < __count && my_merge_error(__sort->merge))
+        __sort->error = 1;
+    return done;
+}
+
+
+/*
+  Sort a file of records into another file
+
+  SYNOPSIS
+    my_extsort_file()
+      from	File of records, its size a multiple of size
+      to	Sorted output, created or truncated. May be from.
+      size, cmp, arg, budget, threads, tmpdir	See my_extsort_init()
+
+  DESCRIPTION
+    The input is read straight into the sort buffer and the output is
+    written in blocks of MY_MERGE_BUFFER_SIZE bytes.
+
+  RETURN VALUE
+    0	Ok
+    1	Error, the output may be incomplete
+*/
+
+MY_GLOBAL_API int my_extsort_file(const char* __from, const char* __to, size_t __size, qsort_cmp2 __cmp,
+                                  const void* __arg, size_t __budget, unsigned int __threads,
+                                  const char* __tmpdir)
+{
+    my_extsort* sort;
+    FILE* file = NULL;
+    unsigned char* out = NULL;
+    size_t records, done, wanted;
+    int error = 1;
+
+    if (!(sort = my_extsort_init(__size, __cmp, __arg, __budget, __threads, __tmpdir)))
+        return 1;
+    if (!(file = fopen(__from, "rb")))
+        goto end;
+    for (;;)
+    {
+        wanted = (sort->capacity - sort->count) * __size;
+        done = fread(sort->buffer + sort->count * __size, 1, wanted, file);
+        sort->count += done / __size;
+        sort->records += done / __size;
+        if (done < wanted)
+            break;
+        if (extsort_spill(sort))
+            goto end;
+    }
+    /* A partial record at the end */
+    if (ferror(file) || done % __size)
+        goto end;
+    fclose(file);
+    file = NULL;
+    if (my_extsort_finish(sort))
+        goto end;
+
+    records = MAX(MY_MERGE_BUFFER_SIZE / __size, 1);
+    if (!(out = (unsigned char*) my_malloc_ex(records * __size, MY_MEM_ARRAY)) ||
+        !(file = fopen(__to, "wb")))
+        goto end;
+    while ((done = my_extsort_next_batch(sort, out, records)))
+    {
+        if (fwrite(out, __size, done, file) != done)
+            goto end;
+    }
+    if (sort->error)
+        goto end;
+    error = fclose(file) != 0;
+    file = NULL;
+
+end:
+    if (file)
+        fclose(file);
+    my_free(out);
+    my_extsort_uninit(sort);
+    my_free(sort);
+    return error;
+}
@@ -15,6 +15,7 @@
 
 #include "my_global_exports.h"
 #include "my_hash.h"
+#include "my_malloc.h"
 
 #define HASH_FULL_ITERATE 2
 #define HASH_GROW_ITERATE 4
@@ -31,7 +32,7 @@ static void rehash(my_hash* __hash)
     my_hash_iter* next;
 
     size = HASH_GROW_STEP * __hash->size;
-    if (!(iter = my_calloc(size, sizeof(*iter))))
+    if (!(iter = my_calloc_ex(size, sizeof(*iter), MY_MEM_HASH)))
         return;    
     for (i = 0; i < __hash->size; i++)
     {
@@ -58,12 +59,12 @@ MY_GLOBAL_API my_hash* my_hash_init(size_t __size, const my_hash_ops* __ops)
 	    (void*) &strcmp,
 	    0, 0, 0, 0 };    
     my_hash* hash;
-    my_hash_iter** iter;
+    my_hash_iter** iter = NULL;
     
     if (!__size) 
         __size = SD_HASH_DEFAULT_SIZE;    
-    if (!(hash = my_calloc(1, sizeof(*hash))) || 
-            !(iter = my_calloc(__size, sizeof(*iter)))) 
+    if (!(hash = my_malloc_padded_ex(sizeof(*hash), MY_MEM_HASH)) || 
+            !(iter = my_calloc_ex(__size, sizeof(*iter), MY_MEM_HASH))) 
     {
 	    my_free(hash);
 	    my_free(iter);
@@ -101,7 +102,7 @@ MY_GLOBAL_API void my_hash_clear(my_hash* __hash)
                 __hash->ops->key_free(pre->key);
 	        if (__hash->ops->value_free) 
                 __hash->ops->value_free(pre->value);
-	        free(pre);
+	        my_free(pre);
 	    }
 	    __hash->iter[idx] = NULL;
     }
@@ -132,7 +133,7 @@ MY_GLOBAL_API my_hash_iter* my_hash_lookadd(my_hash* __hash, const void* __key)
         return NULL;
     if(iter = my_hash_lookup(__hash, __key))
         return pre;
-    if(!(iter = my_calloc(1, sizeof(*iter))))
+    if(!(iter = my_calloc_ex(1, sizeof(*iter), MY_MEM_HASH)))
         return NULL;
     if(__hash->ops->key_dup)
         iter->key = __hash->ops->key_dup(__key);
@@ -23,7 +23,7 @@ MY_GLOBAL_API my_list* my_list_init()
 {
     my_list* list;
  
-    if(!(list = my_malloc(sizeof(my_list))))
+    if(!(list = my_malloc_padded_ex(sizeof(my_list), MY_MEM_LIST)))
 	    return NULL;
     list->head = 0;
     list->tail = 0;
@@ -124,7 +124,7 @@ MY_GLOBAL_API my_list_iter* my_list_add(my_list* __list, void* __data)
     
     if (! __list) 
 	    return 0;    
-    if ((item = my_malloc(sizeof(*item))) == 0)
+    if ((item = my_malloc_ex(sizeof(*item), MY_MEM_LIST)) == 0)
         return 0;    
     item->data = __data;
     item->list = __list; 
@@ -264,7 +264,7 @@ MY_GLOBAL_API my_list_iter* my_list_iter_insert(my_list_iter* __list, void* __da
 	    return 0;    
     if (__list->list->head == __list)
         return my_list_prepend(__list->list, __data);    
-    if ((item = my_malloc(sizeof(*item))) == 0)
+    if ((item = my_malloc_ex(sizeof(*item), MY_MEM_LIST)) == 0)
         return 0;    
     item->data = __data;
     item->list = __list->list;
@@ -284,7 +284,7 @@ MY_GLOBAL_API my_list_iter* my_list_prepend(my_list* __list, void* __data)
     
     if (! __list) 
 	    return 0;    
-    if ((item = my_malloc(sizeof(*item))) == 0)
+    if ((item = my_malloc_ex(sizeof(*item), MY_MEM_LIST)) == 0)
         return 0;    
     item->list = __list;
     item->data = __data;
@@ -307,7 +307,7 @@ MY_GLOBAL_API my_list_iter* my_list_append(my_list* __list, void* __data)
     
     if (! __list) 
 	    return 0;    
-    if ((item = my_malloc(sizeof(*item))) == 0)
+    if ((item = my_malloc_ex(sizeof(*item), MY_MEM_LIST)) == 0)
         return 0;
     item->list = __list;
     item->data = __data;
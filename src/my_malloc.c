@@ -1,6 +1,6 @@
 /*
  * Copyright (c) 2013, Heng Wang personal. All rights reserved.
- * 
+ *
  * Global exports header file.
  *
  * @Author:  Heng.Wang
@@ -11,50 +11,183 @@
  * @Blog  :  http://hengwang.blog.chinaunix.net
  * */
 
+/*
+  Memory allocation entry points used by all containers.
+
+  Every block handed out by my_malloc() is preceded by a small header which
+  records where the block came from and how big the request was. This lets
+  my_free() and my_realloc() work on any block, no matter which mode was
+  active when it was allocated.
+
+  In MY_MALLOC_SLAB mode requests up to MY_SLAB_MAX_SIZE bytes (header
+  included) are rounded up to one of SLAB_CLASSES size classes and served
+  from a per-thread cache: allocation and free are a pointer pop/push on a
+  thread local list and take no lock. When a thread cache runs dry it takes
+  a whole magazine (MY_SLAB_MAGAZINE blocks) from the class depot, and when
+  it holds more than two magazines it hands one back. Blocks freed by
+  another thread than the one that allocated them simply join the freeing
+  thread's cache, so cross-thread frees cost one depot lock per magazine.
+  The depot carves new blocks out of MY_SLAB_CHUNK_SIZE chunks which are
+  only returned to the system by my_malloc_end().
+
+  With MY_MALLOC_STATS every thread counts its allocations in one of
+  MY_MALLOC_SHARDS cache line aligned shards, so the hot path is a few
+  uncontended atomic adds. Live bytes are additionally summed in a thread
+  local counter which is published to a global counter every
+  MY_MALLOC_STATS_BATCH bytes; the peak is tracked on the published value
+  and is thus exact to within MY_MALLOC_STATS_BATCH bytes per thread.
+
+  Requests of mmap_threshold bytes and more are mapped directly with
+  mmap(). Such blocks grow and shrink with mremap(MREMAP_MAYMOVE), which
+  moves page table entries instead of copying the data, so a growing
+  array or hash bucket vector of hundreds of megabytes is never copied.
+  my_malloc_trim() gives the pages past the used part of such a block back
+  to the kernel with MADV_DONTNEED while keeping the address range.
+
+  my_malloc_aligned() over-allocates from malloc() and places the header
+  just below the first aligned address. The two words below the header
+  remember the address returned by malloc() and the alignment.
+  my_malloc_padded() also rounds the size up to a multiple of
+  MY_CACHE_LINE_SIZE, so no other object shares a cache line with it.
+*/
+
+#if defined(__linux__)
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define MY_MALLOC_USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
 #include "my_global_exports.h"
+#include "my_pthread.h"
+#include "my_atomic.h"
+#include "my_malloc.h"
+#include "my_mem_pool.h"
+
+typedef struct my_memory_header_t
+{
+    unsigned short klass;   /* Slab size class or MY_MALLOC_CLASS_SYSTEM */
+    unsigned short tag;     /* enum my_memory_tag the block is accounted to */
+    unsigned int magic;     /* MY_MALLOC_MAGIC, catches foreign pointers */
+    size_t size;            /* Size requested by the caller */
+} my_memory_header;
 
-#if defined(__APPLE__)
-#include <sys/time.h>
-#include <crt_externs.h>
-#define environ (*_NSGetEnviron())
-#endif /* __APPLE__ */
+#define MY_MALLOC_MAGIC         0x4D4D4C43
+#define MY_MALLOC_CLASS_SYSTEM  0xFFFF
+#define MY_MALLOC_CLASS_MMAP    0xFFFE
+#define MY_MALLOC_CLASS_ALIGNED 0xFFFD
 
+#define HEADER_SIZE             MY_ALIGN(sizeof(my_memory_header), 16)
+#define USER_TO_HEADER(P)       ((my_memory_header*) ((char*) (P) - HEADER_SIZE))
+#define HEADER_TO_USER(H)       ((void*) ((char*) (H) + HEADER_SIZE))
 
-typedef void (*malloc_handler_t)();
+/*
+  A free slab block. The first block of a magazine also links the
+  magazines in the depot and knows how many blocks follow it.
+*/
+typedef struct my_slab_free_t
+{
+    struct my_slab_free_t* next;            /* Next free block */
+    struct my_slab_free_t* next_magazine;   /* Next magazine in depot */
+    size_t count;                           /* Blocks in this magazine */
+} my_slab_free;
+
+typedef struct my_slab_depot_t
+{
+    pthread_mutex_t lock;
+    my_slab_free* magazines;    /* Magazines not owned by any thread */
+    void* chunks;               /* Chunks carved for this class */
+} my_slab_depot;
+
+#define SLAB_CLASSES 23
+
+typedef struct my_slab_cache_t
+{
+    my_slab_free* head[SLAB_CLASSES];
+    unsigned int count[SLAB_CLASSES];
+} my_slab_cache;
+
+typedef struct MY_ALIGNED(MY_CACHE_LINE_SIZE) my_malloc_shard_t
+{
+    unsigned long long allocations;
+    unsigned long long frees;
+    unsigned long long bytes_allocated;
+    unsigned long long bytes_freed;
+    unsigned long long histogram[MY_MALLOC_HISTOGRAM];
+    unsigned long long tag_allocations[MY_MEM_TAGS];
+    unsigned long long tag_frees[MY_MEM_TAGS];
+    unsigned long long tag_bytes_allocated[MY_MEM_TAGS];
+    unsigned long long tag_bytes_freed[MY_MEM_TAGS];
+} my_malloc_shard;
+
+/* Block sizes, header included. All are multiples of 16. */
+static const unsigned int slab_class_size[SLAB_CLASSES] = {
+    32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320,
+    384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048 };
+
+/* Maps (size + 15) / 16 to the smallest class that fits size */
+static unsigned char slab_class_index[(MY_SLAB_MAX_SIZE >> 4) + 1];
+
+static unsigned int malloc_flags = MY_MALLOC_SYSTEM;
+static bool slab_ready = FALSE;          /* Depots and cache key exist, until my_malloc_end() */
+static my_slab_depot slab_depot[SLAB_CLASSES];
+static pthread_key(my_slab_cache*, slab_cache_key);
+static MY_THREAD_LOCAL my_slab_cache* slab_cache = NULL;
+
+static my_malloc_shard malloc_shards[MY_MALLOC_SHARDS];
+static unsigned int stats_next_shard = 0;
+static long long stats_live = 0;
+static long long stats_peak = 0;
+static unsigned long long stats_bytes_moved = 0;
+static unsigned long long stats_bytes_remapped = 0;
+static unsigned long long stats_mmap_allocations = 0;
+static MY_THREAD_LOCAL my_malloc_shard* stats_shard = NULL;
+static MY_THREAD_LOCAL long long stats_pending = 0;
 
 static malloc_handler_t handler  = NULL;
 
-static fixup_null_alloc(size_t __length)
+static size_t mmap_threshold = MY_MMAP_THRESHOLD;
+static size_t mmap_page_size = 4096;
+
+/*
+  Called when the system allocator returns NULL
+
+  SYNOPSIS
+    fixup_null_alloc()
+      length	Size of the block that could not be allocated
+
+  DESCRIPTION
+    All memory pools are asked to shed memory, then the handler set by
+    malloc_set_handler() gets a chance. The allocation is retried after
+    each step that may have released memory.
+
+  RETURN
+    pointer	Block of length bytes
+    NULL	Out of memory, the caller reports the failure
+*/
+
+static void* fixup_null_alloc(size_t __length)
 {
     void* data = NULL;
 
-#ifdef HAVE_SBRK
-    static char*  first_break = NULL;
-    size_t allocated;
-    extern char **environ;
-    
-    if(__length == 0)
-    {
-	    data = malloc ((size_t) 1);
-    }
-    if(data == NULL) 
+    if (my_mem_pool_shed(MY_MEM_PRESSURE_OOM, __length))
+        data = malloc(__length);
+    if (!data && handler)
     {
-
-	    if (first_break != NULL)
-	        allocated = (char *) sbrk(0) - first_break;
-	    else
-	        allocated = (char *) sbrk(0) - (char *) &environ;
-	    if(handler) 
-	        handler();
-	    else 
-	        abort();
+        handler();
+        data = malloc(__length);
     }
-#endif
     return data;
 }
 
-malloc_handler_t malloc_set_handler(malloc_handler_t __handler)
+MY_GLOBAL_API malloc_handler_t malloc_set_handler(malloc_handler_t __handler)
 {
     malloc_handler_t previous = handler;
 
@@ -63,45 +196,808 @@ malloc_handler_t malloc_set_handler(malloc_handler_t __handler)
     return previous;
 }
 
-MY_GLOBAL_API void *my_malloc(size_t __length)
+
+/*
+  Carve a new chunk into magazines
+
+  SYNOPSIS
+    slab_carve()
+      depot	Depot of the class, locked by the caller
+      klass	Size class
+
+  DESCRIPTION
+    All magazines but the first are pushed to the depot.
+
+  RETURN
+    First magazine of the chunk
+    NULL	Out of memory
+*/
+
+static my_slab_free* slab_carve(my_slab_depot* depot, unsigned int klass)
 {
-    void* data;
+    size_t size = slab_class_size[klass];
+    size_t blocks, i, j, count;
+    char* chunk;
+    char* start;
+    my_slab_free* first = NULL;
+    my_slab_free* block;
 
-    if(!(data = malloc(__length)))
+    if (!(chunk = (char*) malloc(MY_SLAB_CHUNK_SIZE)))
+        return NULL;
+    *(void**) chunk = depot->chunks;
+    depot->chunks = chunk;
+    start = chunk + HEADER_SIZE;
+    blocks = (MY_SLAB_CHUNK_SIZE - HEADER_SIZE) / size;
+    for (i = 0; i < blocks; i += MY_SLAB_MAGAZINE)
     {
-        data = fixup_null_alloc(__length);
+        count = MIN(blocks - i, MY_SLAB_MAGAZINE);
+        for (j = 0; j < count; j++)
+        {
+            block = (my_slab_free*) (start + (i + j) * size);
+            block->next = (j + 1 < count) ? (my_slab_free*) ((char*) block + size) : NULL;
+        }
+        block = (my_slab_free*) (start + i * size);
+        block->count = count;
+        if (!first)
+            first = block;
+        else
+        {
+            block->next_magazine = depot->magazines;
+            depot->magazines = block;
+        }
     }
-    return data
+    return first;
 }
 
-MY_GLOBAL_API void *my_calloc(size_t __length, size_t __value)
+
+static void slab_depot_push(unsigned int klass, my_slab_free* magazine, size_t count)
+{
+    my_slab_depot* depot = &slab_depot[klass];
+
+    magazine->count = count;
+    pthread_mutex_lock(&depot->lock);
+    magazine->next_magazine = depot->magazines;
+    depot->magazines = magazine;
+    pthread_mutex_unlock(&depot->lock);
+}
+
+
+/*
+  Give back the content of a thread cache to the depots. Registered as
+  destructor of slab_cache_key, so it runs when a thread exits.
+*/
+
+static void slab_cache_destroy(void* arg)
+{
+    my_slab_cache* cache = (my_slab_cache*) arg;
+    unsigned int klass;
+
+    if (!cache)
+        return;
+    for (klass = 0; klass < SLAB_CLASSES; klass++)
+    {
+        if (cache->head[klass])
+            slab_depot_push(klass, cache->head[klass], cache->count[klass]);
+    }
+    if (slab_cache == cache)
+        slab_cache = NULL;
+    free(cache);
+}
+
+
+static my_slab_cache* slab_cache_create(void)
+{
+    my_slab_cache* cache;
+
+    if (!(cache = (my_slab_cache*) calloc(1, sizeof(my_slab_cache))))
+        return NULL;
+    pthread_setspecific(slab_cache_key, cache);
+    return slab_cache = cache;
+}
+
+
+static void* slab_alloc(unsigned int klass)
+{
+    my_slab_cache* cache;
+    my_slab_depot* depot;
+    my_slab_free* block;
+
+    if (!(cache = slab_cache) && !(cache = slab_cache_create()))
+        return NULL;
+    if (!(block = cache->head[klass]))
+    {
+        /* Thread cache is empty, take a full magazine from the depot */
+        depot = &slab_depot[klass];
+        pthread_mutex_lock(&depot->lock);
+        if ((block = depot->magazines))
+            depot->magazines = block->next_magazine;
+        else
+            block = slab_carve(depot, klass);
+        pthread_mutex_unlock(&depot->lock);
+        if (!block)
+            return NULL;
+        cache->count[klass] = (unsigned int) block->count;
+    }
+    cache->head[klass] = block->next;
+    cache->count[klass]--;
+    return block;
+}
+
+
+static void slab_free(void* data, unsigned int klass)
+{
+    my_slab_cache* cache;
+    my_slab_free* block = (my_slab_free*) data;
+    my_slab_free* tail;
+    unsigned int i;
+
+    if (!(cache = slab_cache) && !(cache = slab_cache_create()))
+    {
+        block->next = NULL;
+        slab_depot_push(klass, block, 1);
+        return;
+    }
+    block->next = cache->head[klass];
+    cache->head[klass] = block;
+    if (++cache->count[klass] < 2 * MY_SLAB_MAGAZINE)
+        return;
+
+    /* Too many cached blocks, hand one magazine back to the depot */
+    for (tail = block, i = 1; i < MY_SLAB_MAGAZINE; i++)
+        tail = tail->next;
+    cache->head[klass] = tail->next;
+    cache->count[klass] -= MY_SLAB_MAGAZINE;
+    tail->next = NULL;
+    slab_depot_push(klass, block, MY_SLAB_MAGAZINE);
+}
+
+
+/*
+  Select the allocation mode
+
+  SYNOPSIS
+    my_malloc_init()
+      flags	MY_MALLOC_SYSTEM or MY_MALLOC_SLAB
+
+  NOTES
+    Should be called before other threads start to allocate. Blocks
+    allocated before the call stay valid and are freed to where they
+    came from. Leaving MY_MALLOC_SLAB keeps the slabs for those blocks
+    until my_malloc_end().
+
+  RETURN
+    0	ok
+    1	Could not create the thread cache key
+*/
+
+MY_GLOBAL_API int my_malloc_init(unsigned int __flags)
+{
+    unsigned int klass, idx;
+
+#ifdef MY_MALLOC_USE_MMAP
+    mmap_page_size = (size_t) sysconf(_SC_PAGESIZE);
+#endif
+    if ((__flags & MY_MALLOC_SLAB) && !slab_ready)
+    {
+        if (pthread_key_create(&slab_cache_key, slab_cache_destroy))
+            return 1;
+        for (idx = 0, klass = 0; idx <= (MY_SLAB_MAX_SIZE >> 4); idx++)
+        {
+            while (slab_class_size[klass] < (idx << 4))
+                klass++;
+            slab_class_index[idx] = (unsigned char) klass;
+        }
+        for (klass = 0; klass < SLAB_CLASSES; klass++)
+        {
+            pthread_mutex_init(&slab_depot[klass].lock, NULL);
+            slab_depot[klass].magazines = NULL;
+            slab_depot[klass].chunks = NULL;
+        }
+        slab_ready = TRUE;
+    }
+    malloc_flags = __flags;
+    return 0;
+}
+
+
+/*
+  Release all memory held by the slabs
+
+  NOTES
+    All blocks allocated in MY_MALLOC_SLAB mode must have been freed and
+    other threads must have stopped allocating.
+*/
+
+MY_GLOBAL_API void my_malloc_end(void)
+{
+    unsigned int klass;
+    void* chunk;
+    void* next;
+
+    if (!slab_ready)
+        return;
+    slab_ready = FALSE;
+    malloc_flags = MY_MALLOC_SYSTEM;
+    slab_cache_destroy(slab_cache);
+    pthread_setspecific(slab_cache_key, NULL);
+    pthread_key_delete(slab_cache_key);
+    for (klass = 0; klass < SLAB_CLASSES; klass++)
+    {
+        for (chunk = slab_depot[klass].chunks; chunk; chunk = next)
+        {
+            next = *(void**) chunk;
+            free(chunk);
+        }
+        slab_depot[klass].chunks = NULL;
+        slab_depot[klass].magazines = NULL;
+        pthread_mutex_destroy(&slab_depot[klass].lock);
+    }
+}
+
+
+/*
+  Statistics. Counters of a shard are only read by
+  my_malloc_stats_snapshot(), and are usually only written by one thread.
+*/
+
+static inline my_malloc_shard* stats_get_shard(void)
+{
+    if (!stats_shard)
+        stats_shard = &malloc_shards[my_atomic_add(&stats_next_shard, 1) % MY_MALLOC_SHARDS];
+    return stats_shard;
+}
+
+static inline unsigned int stats_bucket(size_t size)
+{
+    unsigned int bucket = 0;
+
+#if defined(__GNUC__)
+    if (size)
+        bucket = (unsigned int) (sizeof(unsigned long long) * 8 - __builtin_clzll(size));
+#else
+    while (size)
+    {
+        bucket++;
+        size >>= 1;
+    }
+#endif
+    return MIN(bucket, MY_MALLOC_HISTOGRAM - 1);
+}
+
+static void stats_live_add(long long delta)
+{
+    long long live, peak;
+
+    if ((stats_pending += delta) < MY_MALLOC_STATS_BATCH &&
+        stats_pending > -MY_MALLOC_STATS_BATCH)
+        return;
+    live = my_atomic_add(&stats_live, stats_pending) + stats_pending;
+    stats_pending = 0;
+    peak = my_atomic_load(&stats_peak);
+    while (live > peak && !my_atomic_cas(&stats_peak, &peak, live))
+        ;
+}
+
+static void stats_alloc(size_t size, unsigned int tag)
+{
+    my_malloc_shard* shard = stats_get_shard();
+
+    my_atomic_add(&shard->allocations, 1);
+    my_atomic_add(&shard->bytes_allocated, size);
+    my_atomic_add(&shard->histogram[stats_bucket(size)], 1);
+    my_atomic_add(&shard->tag_allocations[tag], 1);
+    my_atomic_add(&shard->tag_bytes_allocated[tag], size);
+    stats_live_add((long long) size);
+}
+
+static void stats_free(size_t size, unsigned int tag)
+{
+    my_malloc_shard* shard = stats_get_shard();
+
+    my_atomic_add(&shard->frees, 1);
+    my_atomic_add(&shard->bytes_freed, size);
+    my_atomic_add(&shard->tag_frees[tag], 1);
+    my_atomic_add(&shard->tag_bytes_freed[tag], size);
+    stats_live_add(-(long long) size);
+}
+
+static void stats_realloc(size_t old_size, size_t new_size, unsigned int tag)
+{
+    my_malloc_shard* shard = stats_get_shard();
+
+    my_atomic_add(&shard->bytes_allocated, new_size);
+    my_atomic_add(&shard->bytes_freed, old_size);
+    my_atomic_add(&shard->tag_bytes_allocated[tag], new_size);
+    my_atomic_add(&shard->tag_bytes_freed[tag], old_size);
+    stats_live_add((long long) new_size - (long long) old_size);
+}
+
+
+/*
+  Read allocation statistics
+
+  SYNOPSIS
+    my_malloc_stats_snapshot()
+      stats	Filled with the sum of all shards
+
+  NOTES
+    Takes no lock. Counters are read one by one while other threads may
+    update them, so the snapshot is only exact when no thread allocates.
+    Only allocations done while MY_MALLOC_STATS was set are counted.
+*/
+
+MY_GLOBAL_API void my_malloc_stats_snapshot(my_malloc_stats* __stats)
+{
+    unsigned int i, j, tag;
+    my_malloc_shard* shard;
+    unsigned long long tag_allocated, tag_freed;
+
+    memset(__stats, 0, sizeof(*__stats));
+    for (i = 0; i < MY_MALLOC_SHARDS; i++)
+    {
+        shard = &malloc_shards[i];
+        __stats->allocations += my_atomic_load(&shard->allocations);
+        __stats->frees += my_atomic_load(&shard->frees);
+        __stats->bytes_allocated += my_atomic_load(&shard->bytes_allocated);
+        __stats->bytes_freed += my_atomic_load(&shard->bytes_freed);
+        for (j = 0; j < MY_MALLOC_HISTOGRAM; j++)
+            __stats->histogram[j] += my_atomic_load(&shard->histogram[j]);
+        for (tag = 0; tag < MY_MEM_TAGS; tag++)
+        {
+            __stats->tags[tag].allocations += my_atomic_load(&shard->tag_allocations[tag]);
+            __stats->tags[tag].frees += my_atomic_load(&shard->tag_frees[tag]);
+            tag_allocated = my_atomic_load(&shard->tag_bytes_allocated[tag]);
+            tag_freed = my_atomic_load(&shard->tag_bytes_freed[tag]);
+            /* Shards may go negative by themselves, only the sum is meaningful */
+            __stats->tags[tag].bytes_live += tag_allocated - tag_freed;
+        }
+    }
+    if (__stats->bytes_allocated > __stats->bytes_freed)
+        __stats->bytes_live = __stats->bytes_allocated - __stats->bytes_freed;
+    for (tag = 0; tag < MY_MEM_TAGS; tag++)
+    {
+        if ((long long) __stats->tags[tag].bytes_live < 0)
+            __stats->tags[tag].bytes_live = 0;
+    }
+    __stats->bytes_peak = MAX((unsigned long long) my_atomic_load(&stats_peak), __stats->bytes_live);
+    __stats->bytes_moved = my_atomic_load(&stats_bytes_moved);
+    __stats->bytes_remapped = my_atomic_load(&stats_bytes_remapped);
+    __stats->mmap_allocations = my_atomic_load(&stats_mmap_allocations);
+}
+
+
+#ifdef MY_MALLOC_USE_MMAP
+
+#define MMAP_LENGTH(size) MY_ALIGN((size), mmap_page_size)
+
+static my_memory_header* mmap_alloc(size_t size)
 {
     void* data;
 
-    if(!(data = calloc(__length, __value)))
+    data = mmap(NULL, MMAP_LENGTH(size), PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    if (malloc_flags & MY_MALLOC_HUGEPAGES)
+        madvise(data, MMAP_LENGTH(size), MADV_HUGEPAGE);
+#endif
+    if (malloc_flags & MY_MALLOC_STATS)
+        my_atomic_add(&stats_mmap_allocations, 1);
+    return (my_memory_header*) data;
+}
+
+/*
+  Resize a mapped block to size bytes (header included). The kernel
+  moves the pages if the range can not grow in place, nothing is copied.
+*/
+
+static my_memory_header* mmap_resize(my_memory_header* header, size_t size)
+{
+    size_t old_length = MMAP_LENGTH(header->size + HEADER_SIZE);
+    size_t new_length = MMAP_LENGTH(size);
+    void* data;
+
+    if (old_length == new_length)
+        return header;
+    data = mremap(header, old_length, new_length, MREMAP_MAYMOVE);
+    if (data == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    if ((malloc_flags & MY_MALLOC_HUGEPAGES) && new_length > old_length)
+        madvise(data, new_length, MADV_HUGEPAGE);
+#endif
+    return (my_memory_header*) data;
+}
+
+#endif /* MY_MALLOC_USE_MMAP */
+
+
+/* Resize a system or mapped block in place, once */
+
+static my_memory_header* block_resize_once(my_memory_header* header, size_t size)
+{
+#ifdef MY_MALLOC_USE_MMAP
+    if (header->klass == MY_MALLOC_CLASS_MMAP)
+        return mmap_resize(header, size);
+#endif
+    return (my_memory_header*) realloc(header, size);
+}
+
+/*
+  Resize a system or mapped block in place, freeing memory if needed
+
+  SYNOPSIS
+    block_resize()
+      header	Block to resize
+      size	New size, header included
+
+  DESCRIPTION
+    When the system refuses, memory pools are asked to shed memory and
+    the handler is called as in fixup_null_alloc(), retrying the resize
+    after each step. Blocks that move by allocating a new one go through
+    block_alloc() or my_malloc_aligned_ex(), which already do this.
+
+  RETURN
+    header	Resized block, the old pointer is no longer valid
+    NULL	Out of memory, the block is unchanged
+*/
+
+static my_memory_header* block_resize(my_memory_header* header, size_t size)
+{
+    my_memory_header* new_header;
+
+    if ((new_header = block_resize_once(header, size)))
+        return new_header;
+    if (my_mem_pool_shed(MY_MEM_PRESSURE_OOM, size))
+        new_header = block_resize_once(header, size);
+    if (!new_header && handler)
+    {
+        handler();
+        new_header = block_resize_once(header, size);
+    }
+    return new_header;
+}
+
+
+/*
+  Get a block of size bytes (header included) from the slabs, the
+  system or a private mapping, depending on the mode and size.
+*/
+
+static my_memory_header* block_alloc(size_t size)
+{
+    my_memory_header* header;
+    unsigned int klass = MY_MALLOC_CLASS_SYSTEM;
+
+    if ((malloc_flags & MY_MALLOC_SLAB) && size <= MY_SLAB_MAX_SIZE)
+    {
+        klass = slab_class_index[(size + 15) >> 4];
+        header = (my_memory_header*) slab_alloc(klass);
+    }
+#ifdef MY_MALLOC_USE_MMAP
+    else if (mmap_threshold && size >= mmap_threshold &&
+             (header = mmap_alloc(size)))
+        klass = MY_MALLOC_CLASS_MMAP;
+#endif
+    else
+        header = (my_memory_header*) malloc(size);
+    if (!header)
     {
-        data = fixup_null_alloc(__length*__value);
+        klass = MY_MALLOC_CLASS_SYSTEM;
+        if (!(header = (my_memory_header*) fixup_null_alloc(size)))
+            return NULL;
     }
-    return data
+    header->klass = (unsigned short) klass;
+    header->magic = MY_MALLOC_MAGIC;
+    return header;
+}
+
+static void block_free(my_memory_header* header)
+{
+    assert(header->magic == MY_MALLOC_MAGIC);
+    header->magic = 0;
+    if (header->klass == MY_MALLOC_CLASS_SYSTEM)
+        free(header);
+    else if (header->klass == MY_MALLOC_CLASS_ALIGNED)
+        free(((void**) header)[-1]);
+#ifdef MY_MALLOC_USE_MMAP
+    else if (header->klass == MY_MALLOC_CLASS_MMAP)
+        munmap(header, MMAP_LENGTH(header->size + HEADER_SIZE));
+#endif
+    else
+        slab_free(header, header->klass);
+}
+
+
+MY_GLOBAL_API void *my_malloc(size_t __length)
+{
+    return my_malloc_ex(__length, MY_MEM_UNKNOWN);
+}
+
+MY_GLOBAL_API void *my_calloc(size_t __length, size_t __value)
+{
+    return my_calloc_ex(__length, __value, MY_MEM_UNKNOWN);
 }
 
 MY_GLOBAL_API void *my_realloc(void* __data, size_t __length)
 {
+    return my_realloc_ex(__data, __length, MY_MEM_UNKNOWN);
+}
+
+MY_GLOBAL_API void *my_malloc_ex(size_t __length, unsigned int __tag)
+{
+    my_memory_header* header;
+    size_t size = __length + HEADER_SIZE;
+
+    if (size < __length || !(header = block_alloc(size)))
+        return NULL;
+    if (__tag >= MY_MEM_TAGS)
+        __tag = MY_MEM_UNKNOWN;
+    header->tag = (unsigned short) __tag;
+    header->size = __length;
+    if (malloc_flags & MY_MALLOC_STATS)
+        stats_alloc(__length, __tag);
+    return HEADER_TO_USER(header);
+}
+
+MY_GLOBAL_API void *my_calloc_ex(size_t __length, size_t __value, unsigned int __tag)
+{
+    void* data;
+    size_t size = __length * __value;
+
+    if (__value && size / __value != __length)
+        return NULL;
+    if ((data = my_malloc_ex(size, __tag)) &&
+        USER_TO_HEADER(data)->klass != MY_MALLOC_CLASS_MMAP)
+        memset(data, 0, size);  /* Fresh mappings are already zero */
+    return data;
+}
+
+/*
+  Resize a block. The block keeps the tag it was allocated with, __tag is
+  only used when __data is NULL.
+
+  Mapped blocks are resized with mremap(). A block that grows past
+  mmap_threshold is copied into a mapping once, after which it is never
+  copied again.
+
+  Out of memory, pools are asked to shed and the handler is called as in
+  my_malloc_ex(). If that does not help NULL is returned and __data is
+  left unchanged.
+*/
+
+MY_GLOBAL_API void *my_realloc_ex(void* __data, size_t __length, unsigned int __tag)
+{
+    my_memory_header* header;
+    my_memory_header* new_header;
+    void* data;
+    size_t old_size;
+    size_t size = __length + HEADER_SIZE;
+
     if(!__data)
+        return my_malloc_ex(__length, __tag);
+    if (size < __length)
+        return NULL;
+    header = USER_TO_HEADER(__data);
+    assert(header->magic == MY_MALLOC_MAGIC);
+    old_size = header->size;
+#ifdef MY_MALLOC_USE_MMAP
+    if (header->klass == MY_MALLOC_CLASS_MMAP)
+    {
+        if (!(new_header = block_resize(header, size)))
+            return NULL;
+        if (malloc_flags & MY_MALLOC_STATS)
+            my_atomic_add(&stats_bytes_remapped, MIN(old_size, __length));
+    }
+    else if (header->klass == MY_MALLOC_CLASS_SYSTEM &&
+             mmap_threshold && size >= mmap_threshold && __length > old_size &&
+             (new_header = mmap_alloc(size)))
     {
-        return malloc(__length);
+        /* If the mapping fails, realloc() below may still succeed */
+        new_header->klass = MY_MALLOC_CLASS_MMAP;
+        new_header->magic = MY_MALLOC_MAGIC;
+        new_header->tag = header->tag;
+        memcpy(HEADER_TO_USER(new_header), __data, old_size);
+        block_free(header);
+        if (malloc_flags & MY_MALLOC_STATS)
+            my_atomic_add(&stats_bytes_moved, old_size);
     }
-    if(!(__data = realloc(__data, __length)))
+    else
+#endif
+    if (header->klass == MY_MALLOC_CLASS_SYSTEM)
     {
-        __data = fixup_null_alloc(__length);
+        if (!(new_header = block_resize(header, size)))
+            return NULL;
+        if (new_header != header && (malloc_flags & MY_MALLOC_STATS))
+            my_atomic_add(&stats_bytes_moved, MIN(old_size, __length));
     }
+    else if (header->klass == MY_MALLOC_CLASS_ALIGNED)
+    {
+        /* Keep the alignment, the block can only move by copying */
+        if (!(data = my_malloc_aligned_ex(__length, ((size_t*) header)[-2], header->tag)))
+            return NULL;
+        memcpy(data, __data, MIN(old_size, __length));
+        my_free(__data);
+        if (malloc_flags & MY_MALLOC_STATS)
+            my_atomic_add(&stats_bytes_moved, MIN(old_size, __length));
+        return data;
+    }
+    else if (size <= slab_class_size[header->klass])
+    {
+        /* Still fits in the same slab block */
+        new_header = header;
+    }
+    else
+    {
+        if (!(new_header = block_alloc(size)))
+            return NULL;
+        new_header->tag = header->tag;
+        memcpy(HEADER_TO_USER(new_header), __data, MIN(old_size, __length));
+        block_free(header);
+        if (malloc_flags & MY_MALLOC_STATS)
+            my_atomic_add(&stats_bytes_moved, MIN(old_size, __length));
+    }
+    new_header->size = __length;
+    if (malloc_flags & MY_MALLOC_STATS)
+        stats_realloc(old_size, __length, new_header->tag);
+    return HEADER_TO_USER(new_header);
+}
 
-    return __data
+MY_GLOBAL_API void *my_free(void* __data)
+{
+    my_memory_header* header;
 
+    if (!__data)
+        return NULL;
+    header = USER_TO_HEADER(__data);
+    if (malloc_flags & MY_MALLOC_STATS)
+        stats_free(header->size, header->tag);
+    block_free(header);
+    return NULL;
 }
 
-MY_GLOBAL_API void *my_free(void* __data)
+
+/*
+  Allocate memory on a given alignment
+
+  SYNOPSIS
+    my_malloc_aligned_ex()
+      length	Bytes wanted
+      alignment	Power of two, at least 16
+      tag	enum my_memory_tag to account the block to
+
+  NOTES
+    The block is freed with my_free() or my_free_aligned() and keeps its
+    alignment through my_realloc().
+
+  RETURN
+    pointer	Block starting on a multiple of alignment
+    NULL	Out of memory or bad alignment
+*/
+
+MY_GLOBAL_API void *my_malloc_aligned_ex(size_t __length, size_t __alignment, unsigned int __tag)
 {
-    free(__data);
+    my_memory_header* header;
+    char* raw;
+    char* data;
+    size_t extra, size;
+
+    if (__alignment < 16)
+        __alignment = 16;
+    if (__alignment & (__alignment - 1))
+        return NULL;
+    extra = __alignment + HEADER_SIZE + 2 * sizeof(void*);
+    if ((size = __length + extra) < __length)
+        return NULL;
+    if (!(raw = (char*) malloc(size)) && !(raw = (char*) fixup_null_alloc(size)))
+        return NULL;
+    data = (char*) MY_ALIGN((size_t) (raw + HEADER_SIZE + 2 * sizeof(void*)), __alignment);
+    header = USER_TO_HEADER(data);
+    ((void**) header)[-1] = raw;
+    ((size_t*) header)[-2] = __alignment;
+    if (__tag >= MY_MEM_TAGS)
+        __tag = MY_MEM_UNKNOWN;
+    header->klass = MY_MALLOC_CLASS_ALIGNED;
+    header->tag = (unsigned short) __tag;
+    header->magic = MY_MALLOC_MAGIC;
+    header->size = __length;
+    if (malloc_flags & MY_MALLOC_STATS)
+        stats_alloc(__length, __tag);
+    return data;
+}
+
+MY_GLOBAL_API void *my_malloc_aligned(size_t __length, size_t __alignment)
+{
+    return my_malloc_aligned_ex(__length, __alignment, MY_MEM_UNKNOWN);
 }
 
+/*
+  Allocate an object that owns all the cache lines it touches. Use it
+  for locks, counters and container headers written by different threads.
+*/
+
+MY_GLOBAL_API void *my_malloc_padded_ex(size_t __length, unsigned int __tag)
+{
+    return my_malloc_aligned_ex(MY_ALIGN(MAX(__length, 1), MY_CACHE_LINE_SIZE),
+                                MY_CACHE_LINE_SIZE, __tag);
+}
+
+MY_GLOBAL_API void *my_malloc_padded(size_t __length)
+{
+    return my_malloc_padded_ex(__length, MY_MEM_UNKNOWN);
+}
+
+MY_GLOBAL_API void *my_free_aligned(void* __data)
+{
+    return my_free(__data);
+}
+
+
+/*
+  Number of bytes requested for a block returned by my_malloc()
+*/
+
+MY_GLOBAL_API size_t my_malloc_size(const void* __data)
+{
+    return __data ? USER_TO_HEADER(__data)->size : 0;
+}
+
+
+/*
+  Give unused pages of a block back to the system
+
+  SYNOPSIS
+    my_malloc_trim()
+      data	Block returned by my_malloc()
+      used	Number of leading bytes that are still in use
+
+  DESCRIPTION
+    For mapped blocks the whole pages after the first used bytes are
+    released with MADV_DONTNEED. The block keeps its size and address;
+    released pages read back as zero when touched again.
+
+  RETURN
+    Number of bytes given back, 0 if the block is not mapped
+*/
+
+MY_GLOBAL_API size_t my_malloc_trim(void* __data, size_t __used)
+{
+#ifdef MY_MALLOC_USE_MMAP
+    my_memory_header* header;
+    size_t start, end;
+
+    if (!__data)
+        return 0;
+    header = USER_TO_HEADER(__data);
+    if (header->klass != MY_MALLOC_CLASS_MMAP || __used >= header->size)
+        return 0;
+    start = MMAP_LENGTH(__used + HEADER_SIZE);
+    end = MMAP_LENGTH(header->size + HEADER_SIZE);
+    if (start >= end || madvise((char*) header + start, end - start, MADV_DONTNEED))
+        return 0;
+    return end - start;
+#else
+    return 0;
+#endif
+}
+
+
+/*
+  Set the size from which blocks are mapped directly
+
+  SYNOPSIS
+    my_malloc_set_mmap_threshold()
+      threshold	Size in bytes, 0 disables mapping
+
+  RETURN
+    Previous threshold
+*/
+
+MY_GLOBAL_API size_t my_malloc_set_mmap_threshold(size_t __threshold)
+{
+    size_t previous = mmap_threshold;
+
+    mmap_threshold = __threshold;
+    return previous;
+}
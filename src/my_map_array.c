@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * File backed array.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  The file is a my_map_array_header followed by number elements, of
+  which the first elements are in use. It is mapped MAP_SHARED, so every
+  store lands in the page cache and other processes mapping the file see
+  it; my_map_array_sync() forces it to disk.
+
+  Growing extends the file with ftruncate() following the growth policy
+  of my_array and maps it again, which moves the buffer like a realloc:
+  pointers into the array must be taken again after a growth.
+
+  One process may modify a file at a time; readers call
+  my_map_array_refresh() to follow a writer that grew it.
+
+  Only POSIX systems are supported; elsewhere my_map_array_open() fails.
+*/
+
+#include <limits.h>
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_map_array.h"
+
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAP_ARRAY_LENGTH(array, number) \
+    (MY_MAP_ARRAY_HEADER_SIZE + (size_t) (number) * (array)->size)
+
+
+/*
+  Map the first length bytes of the file, replacing the current mapping
+*/
+
+static int map_array_map(my_map_array* __array, size_t __length)
+{
+    unsigned char* map;
+    int prot = PROT_READ;
+
+    if (!(__array->flags & MY_MAP_ARRAY_READ_ONLY))
+        prot |= PROT_WRITE;
+    if ((map = (unsigned char*) mmap(NULL, __length, prot, MAP_SHARED, __array->fd, 0)) ==
+        (unsigned char*) MAP_FAILED)
+        return 1;
+    if (__array->map)
+        munmap(__array->map, __array->map_length);
+    __array->map = map;
+    __array->map_length = __length;
+    __array->header = (my_map_array_header*) map;
+    __array->buffer = map + MY_MAP_ARRAY_HEADER_SIZE;
+    return 0;
+}
+
+
+/*
+  Open or create a file backed array
+
+  SYNOPSIS
+    my_map_array_open()
+      path	File name
+      size	Size of an element. 0 to accept the size stored in an
+                existing file.
+      flags	MY_MAP_ARRAY_CREATE, MY_MAP_ARRAY_TRUNCATE,
+                MY_MAP_ARRAY_READ_ONLY
+
+  DESCRIPTION
+    An existing file is mapped as is, after checking its header: opening
+    costs no read of the elements, pages are loaded on first access.
+
+  RETURN VALUE
+    pointer	Ok, close it with my_map_array_close()
+    NULL	The file could not be opened or mapped, or it is not an
+                array of elements of size bytes
+*/
+
+MY_GLOBAL_API my_map_array* my_map_array_open(const char* __path, unsigned int __size, unsigned int __flags)
+{
+    my_map_array* array;
+    my_map_array_header header;
+    struct stat stat_info;
+    int open_flags;
+
+    if (!(array = (my_map_array*) my_malloc_ex(sizeof(my_map_array), MY_MEM_ARRAY)))
+        return NULL;
+    memset(array, 0, sizeof(my_map_array));
+    array->flags = __flags;
+    array->growth.policy = MY_ARRAY_GROW_GEOMETRIC;
+    array->growth.factor = MY_ARRAY_GROW_FACTOR;
+    array->growth.increment = ARRAY_INIT_INCREMENT;
+    array->growth.max_increment = 0;
+
+    if (__flags & MY_MAP_ARRAY_READ_ONLY)
+        open_flags = O_RDONLY;
+    else
+    {
+        open_flags = O_RDWR;
+        if (__flags & MY_MAP_ARRAY_CREATE)
+            open_flags |= O_CREAT;
+        if (__flags & MY_MAP_ARRAY_TRUNCATE)
+            open_flags |= O_TRUNC;
+    }
+    if ((array->fd = open(__path, open_flags, 0644)) < 0)
+        goto err;
+    if (fstat(array->fd, &stat_info))
+        goto err;
+
+    if (stat_info.st_size == 0 && !(__flags & MY_MAP_ARRAY_READ_ONLY))
+    {
+        /* New file, write the header */
+        if (!__size)
+            goto err;
+        memset(&header, 0, sizeof(header));
+        header.magic = MY_MAP_ARRAY_MAGIC;
+        header.version = MY_MAP_ARRAY_VERSION;
+        header.size = __size;
+        array->size = __size;
+        if (ftruncate(array->fd, (off_t) MAP_ARRAY_LENGTH(array, 0)) ||
+            map_array_map(array, MAP_ARRAY_LENGTH(array, 0)))
+            goto err;
+        memcpy(array->header, &header, sizeof(header));
+        return array;
+    }
+
+    if ((size_t) stat_info.st_size < MY_MAP_ARRAY_HEADER_SIZE ||
+        pread(array->fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header) ||
+        header.magic != MY_MAP_ARRAY_MAGIC || header.version != MY_MAP_ARRAY_VERSION ||
+        !header.size || (__size && header.size != __size) ||
+        header.elements > header.number || header.number > UINT_MAX)
+        goto err;
+    array->size = header.size;
+    if ((size_t) stat_info.st_size < MAP_ARRAY_LENGTH(array, header.number) ||
+        map_array_map(array, MAP_ARRAY_LENGTH(array, header.number)))
+        goto err;
+    return array;
+
+err:
+    if (array->fd >= 0)
+        close(array->fd);
+    my_free(array);
+    return NULL;
+}
+
+
+/*
+  Unmap and close the array, the file keeps its content
+
+  RETURN VALUE
+    0	Ok
+    1	Closing the file failed
+*/
+
+MY_GLOBAL_API int my_map_array_close(my_map_array* __array)
+{
+    int error;
+
+    if (__array->map)
+        munmap(__array->map, __array->map_length);
+    error = close(__array->fd) != 0;
+    my_free(__array);
+    return error;
+}
+
+
+/*
+  Resize the file to exactly number elements and map it again
+*/
+
+static int map_array_resize(my_map_array* __array, unsigned int __number)
+{
+    size_t length = MAP_ARRAY_LENGTH(__array, __number);
+
+    if (__array->flags & MY_MAP_ARRAY_READ_ONLY)
+        return 1;
+    if (ftruncate(__array->fd, (off_t) length) || map_array_map(__array, length))
+        return 1;
+    __array->header->number = __number;
+    return 0;
+}
+
+
+/*
+  Make room for a number of elements
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	The file could not be extended, or it is read only
+*/
+
+MY_GLOBAL_API int my_map_array_reserve(my_map_array* __array, unsigned int __number)
+{
+    if (__number <= __array->header->number)
+        return 0;
+    return map_array_resize(__array, __number);
+}
+
+
+static int map_array_allocate(my_map_array* __array, unsigned int __number)
+{
+    if (__number <= __array->header->number)
+        return 0;
+    return map_array_resize(__array, my_array_grow(&__array->growth,
+                                                   (unsigned int) __array->header->number, __number));
+}
+
+
+/*
+  Alloc space for the next element, see my_array_alloc()
+*/
+
+MY_GLOBAL_API void* my_map_array_alloc(my_map_array* __array)
+{
+    unsigned int elements = my_map_array_elements(__array);
+
+    if ((__array->flags & MY_MAP_ARRAY_READ_ONLY) || elements == UINT_MAX ||
+        map_array_allocate(__array, elements + 1))
+        return NULL;
+    __array->header->elements = elements + 1;
+    return __array->buffer + (size_t) elements * __array->size;
+}
+
+
+MY_GLOBAL_API int my_map_array_insert(my_map_array* __array, const void* __element)
+{
+    void* buffer;
+
+    if (!(buffer = my_map_array_alloc(__array)))
+        return 1;
+    memcpy(buffer, __element, __array->size);
+    return 0;
+}
+
+
+/*
+  Append count elements with one growth of the file
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	The file could not be extended, or it is read only
+*/
+
+MY_GLOBAL_API int my_map_array_append(my_map_array* __array, const void* __elements, unsigned int __count)
+{
+    unsigned int elements = my_map_array_elements(__array);
+
+    if ((__array->flags & MY_MAP_ARRAY_READ_ONLY) || __count > UINT_MAX - elements ||
+        map_array_allocate(__array, elements + __count))
+        return 1;
+    memcpy(__array->buffer + (size_t) elements * __array->size, __elements,
+           (size_t) __count * __array->size);
+    __array->header->elements = elements + __count;
+    return 0;
+}
+
+
+MY_GLOBAL_API void* my_map_array_pop(my_map_array* __array)
+{
+    if ((__array->flags & MY_MAP_ARRAY_READ_ONLY) || !__array->header->elements)
+        return NULL;
+    return __array->buffer + (size_t) --__array->header->elements * __array->size;
+}
+
+
+/*
+  Write the modified pages to the file
+
+  SYNOPSIS
+    my_map_array_sync()
+      array
+      wait	TRUE to return once the data is on disk, FALSE to only
+                schedule the writes
+
+  RETURN VALUE
+    0	Ok
+    1	msync() failed
+*/
+
+MY_GLOBAL_API int my_map_array_sync(my_map_array* __array, bool __wait)
+{
+    size_t used = MAP_ARRAY_LENGTH(__array, __array->header->elements);
+
+    return msync(__array->map, MIN(used, __array->map_length), __wait ? MS_SYNC : MS_ASYNC) != 0;
+}
+
+
+/*
+  Follow a file grown by another process
+
+  DESCRIPTION
+    The element count is read from the shared header at each access,
+    but a growth of the file by another process is only seen once the
+    file is mapped again. Does nothing if the capacity did not change.
+
+  RETURN VALUE
+    0	Ok
+    1	The file could not be mapped again
+*/
+
+MY_GLOBAL_API int my_map_array_refresh(my_map_array* __array)
+{
+    size_t length = MAP_ARRAY_LENGTH(__array, __array->header->number);
+
+    if (length == __array->map_length)
+        return 0;
+    return map_array_map(__array, length);
+}
+
+#else /* _WIN32 */
+
+MY_GLOBAL_API my_map_array* my_map_array_open(const char* __path, unsigned int __size, unsigned int __flags)
+{
+    return NULL;
+}
+
+MY_GLOBAL_API int my_map_array_close(my_map_array* __array) { return 1; }
+MY_GLOBAL_API int my_map_array_reserve(my_map_array* __array, unsigned int __number) { return 1; }
+MY_GLOBAL_API void* my_map_array_alloc(my_map_array* __array) { return NULL; }
+MY_GLOBAL_API int my_map_array_insert(my_map_array* __array, const void* __element) { return 1; }
+MY_GLOBAL_API int my_map_array_append(my_map_array* __array, const void* __elements, unsigned int __count) { return 1; }
+MY_GLOBAL_API void* my_map_array_pop(my_map_array* __array) { return NULL; }
+MY_GLOBAL_API int my_map_array_sync(my_map_array* __array, bool __wait) { return 1; }
+MY_GLOBAL_API int my_map_array_refresh(my_map_array* __array) { return 1; }
+
+#endif /* _WIN32 */
+
+
+/*
+  Describe the mapped elements as a my_array
+
+  SYNOPSIS
+    my_map_array_view()
+      array
+      view	Filled to point at the mapped elements
+
+  DESCRIPTION
+    The view lets the read and in place functions of my_array, like
+    my_array_find() or my_array_sort(), work on the file. The view does
+    not own the buffer (MY_ARRAY_INIT_BUFFER_USED): growing it copies the
+    elements to memory, and it is stale after the file array grows.
+*/
+
+MY_GLOBAL_API void my_map_array_view(my_map_array* __array, my_array* __view)
+{
+    memset(__view, 0, sizeof(my_array));
+    __view->buffer = __array->buffer;
+    __view->elements = my_map_array_elements(__array);
+    __view->number = (unsigned int) __array->header->number;
+    __view->size = __array->size;
+    __view->flags = MY_ARRAY_INIT_BUFFER_USED;
+    __view->growth = __array->growth;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Memory budgets.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  A pool only counts bytes, it does not own memory. Containers reserve
+  before they allocate and release after they free, or use
+  my_mem_pool_malloc()/my_mem_pool_free() which do both.
+
+  Crossing the soft limit calls the pressure callback once with
+  MY_MEM_PRESSURE_SOFT, it is called again only after usage dropped below
+  the soft limit. A reservation that would cross the hard limit calls it
+  with MY_MEM_PRESSURE_HARD and is retried once if the callback released
+  enough memory, otherwise it is refused and the caller decides what to
+  do. When malloc() itself fails, my_malloc() asks every registered pool
+  to shed memory with MY_MEM_PRESSURE_OOM before giving up.
+*/
+
+#include "my_global_exports.h"
+#include "my_pthread.h"
+#include "my_atomic.h"
+#include "my_malloc.h"
+#include "my_mem_pool.h"
+
+static pthread_mutex_t pool_lock;
+static pthread_cond_t pool_shed_done;
+static my_pthread_once_t pool_once = MY_PTHREAD_ONCE_INIT;
+static my_mem_pool* pool_list = NULL;
+
+
+/*
+  Initialize the lock of the pool list on first use. There are no static
+  initializers for a mutex or condition on every platform.
+*/
+
+static void pool_lock_init(void)
+{
+    pthread_mutex_init(&pool_lock, NULL);
+    pthread_cond_init(&pool_shed_done, NULL);
+}
+
+
+/*
+  Initialize a pool and register it
+
+  SYNOPSIS
+    my_mem_pool_init()
+      pool		Pool to initialize
+      name		Name, for diagnostics. Not copied.
+      soft_limit	Bytes above which the owner is asked to shed, 0 if none
+      hard_limit	Bytes reservations can not exceed, 0 if none
+*/
+
+MY_GLOBAL_API void my_mem_pool_init(my_mem_pool* pool, const char* name, size_t soft_limit, size_t hard_limit)
+{
+    pool->name = name;
+    pool->used = 0;
+    pool->peak = 0;
+    pool->soft_limit = soft_limit;
+    pool->hard_limit = hard_limit;
+    pool->pressure = NULL;
+    pool->pressure_arg = NULL;
+    pool->in_pressure = 0;
+    pool->soft_signaled = 0;
+    pool->failed = 0;
+    pool->shedding = 0;
+    my_pthread_once(&pool_once, pool_lock_init);
+    pthread_mutex_lock(&pool_lock);
+    pool->next = pool_list;
+    pool_list = pool;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+/*
+  Unregister a pool
+
+  NOTES
+    Waits for my_mem_pool_shed() calls running the callback of the pool,
+    so it must not be called from that callback.
+*/
+
+MY_GLOBAL_API void my_mem_pool_uninit(my_mem_pool* pool)
+{
+    my_mem_pool** prev;
+
+    my_pthread_once(&pool_once, pool_lock_init);
+    pthread_mutex_lock(&pool_lock);
+    while (pool->shedding)
+        pthread_cond_wait(&pool_shed_done, &pool_lock);
+    for (prev = &pool_list; *prev; prev = &(*prev)->next)
+    {
+        if (*prev == pool)
+        {
+            *prev = pool->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    pool->next = NULL;
+}
+
+
+MY_GLOBAL_API void my_mem_pool_set_pressure(my_mem_pool* pool, my_mem_pool_pressure pressure, void* arg)
+{
+    pool->pressure_arg = arg;
+    pool->pressure = pressure;
+}
+
+
+MY_GLOBAL_API void my_mem_pool_set_limits(my_mem_pool* pool, size_t soft_limit, size_t hard_limit)
+{
+    pool->soft_limit = soft_limit;
+    pool->hard_limit = hard_limit;
+    pool->soft_signaled = 0;
+}
+
+
+/*
+  Call the pressure callback of a pool unless it is already running.
+*/
+
+static size_t pool_pressure(my_mem_pool* pool, int level, size_t wanted)
+{
+    int expected = 0;
+    size_t released;
+
+    if (!pool->pressure || !my_atomic_cas(&pool->in_pressure, &expected, 1))
+        return 0;
+    released = (*pool->pressure)(pool, level, wanted, pool->pressure_arg);
+    my_atomic_store_release(&pool->in_pressure, 0);
+    return released;
+}
+
+
+/*
+  Charge bytes to a pool
+
+  SYNOPSIS
+    my_mem_pool_reserve()
+      pool		Pool to charge
+      size		Number of bytes
+
+  RETURN
+    0	ok
+    1	Hard limit would be exceeded, nothing was charged
+*/
+
+MY_GLOBAL_API int my_mem_pool_reserve(my_mem_pool* pool, size_t size)
+{
+    long long used, peak;
+    int retry;
+
+    for (retry = 0; ; retry++)
+    {
+        used = my_atomic_add(&pool->used, (long long) size) + (long long) size;
+        if (!pool->hard_limit || used <= (long long) pool->hard_limit)
+            break;
+        my_atomic_add(&pool->used, -(long long) size);
+        if (retry || pool_pressure(pool, MY_MEM_PRESSURE_HARD, size) < size)
+        {
+            my_atomic_add(&pool->failed, 1);
+            return 1;
+        }
+    }
+
+    peak = my_atomic_load(&pool->peak);
+    while (used > peak && !my_atomic_cas(&pool->peak, &peak, used))
+        ;
+    if (pool->soft_limit && used > (long long) pool->soft_limit &&
+        !my_atomic_load(&pool->soft_signaled))
+    {
+        my_atomic_store(&pool->soft_signaled, 1);
+        pool_pressure(pool, MY_MEM_PRESSURE_SOFT, size);
+    }
+    return 0;
+}
+
+
+MY_GLOBAL_API void my_mem_pool_release(my_mem_pool* pool, size_t size)
+{
+    long long used = my_atomic_add(&pool->used, -(long long) size) - (long long) size;
+
+    if (pool->soft_limit && used <= (long long) pool->soft_limit &&
+        my_atomic_load(&pool->soft_signaled))
+        my_atomic_store(&pool->soft_signaled, 0);
+}
+
+
+/*
+  Allocate memory charged to a pool
+
+  RETURN
+    pointer	ok
+    NULL	Hard limit reached or out of memory
+*/
+
+MY_GLOBAL_API void* my_mem_pool_malloc(my_mem_pool* pool, size_t size, unsigned int tag)
+{
+    void* data;
+
+    if (my_mem_pool_reserve(pool, size))
+        return NULL;
+    if (!(data = my_malloc_ex(size, tag)))
+        my_mem_pool_release(pool, size);
+    return data;
+}
+
+
+MY_GLOBAL_API void my_mem_pool_free(my_mem_pool* pool, void* data)
+{
+    if (!data)
+        return;
+    my_mem_pool_release(pool, my_malloc_size(data));
+    my_free(data);
+}
+
+
+/*
+  Ask all pools to give memory back
+
+  SYNOPSIS
+    my_mem_pool_shed()
+      level	MY_MEM_PRESSURE_SOFT or MY_MEM_PRESSURE_OOM
+      wanted	Bytes needed
+
+  NOTES
+    Pools are asked in registration order, most recently registered first,
+    until enough memory was released. Callbacks must not register or
+    unregister pools.
+
+    The callbacks run without the lock of the pool list, so they may
+    allocate: an allocation failing inside a callback sheds the other
+    pools, a callback already running is skipped. The pool being asked
+    stays registered until its callback returns.
+
+  RETURN
+    Number of bytes released
+*/
+
+MY_GLOBAL_API size_t my_mem_pool_shed(int level, size_t wanted)
+{
+    my_mem_pool* pool;
+    size_t released = 0;
+
+    my_pthread_once(&pool_once, pool_lock_init);
+    pthread_mutex_lock(&pool_lock);
+    for (pool = pool_list; pool && released < wanted; pool = pool->next)
+    {
+        if (!pool->pressure)
+            continue;
+        pool->shedding++;
+        pthread_mutex_unlock(&pool_lock);
+        released += pool_pressure(pool, level, wanted - released);
+        pthread_mutex_lock(&pool_lock);
+        if (!--pool->shedding)
+            pthread_cond_broadcast(&pool_shed_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return released;
+}
@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * K-way merge.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  The cursors of the runs are kept in a my_queue ordered by their next
+  record, the run with the lowest record on top. Taking a record
+  advances the top cursor and repairs the heap with queue_replaced(),
+  one _downheap() pass; an exhausted cursor leaves the queue.
+
+  my_merge_next_batch() copies records to an output array. It looks at
+  the best child of the top, the run that comes next, and copies all the
+  records of the top run that go before it at once, found by galloping,
+  so the heap is only repaired when the merge switches runs. Merging
+  runs that are already partly ordered costs little more than a copy.
+
+  Equal records come out in the order of their runs, the merge is
+  stable.
+
+  File runs are read with pread() into a buffer of each run, at the
+  offset of the run, so several runs may share one file. After each read
+  the kernel is asked to read the next buffer ahead.
+*/
+
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_merge.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define CURSOR_RECORD(merge, cursor, pos) ((cursor)->buffer + (pos) * (merge)->size)
+
+
+/*
+  Compare the next records of two cursors, equal records by run
+*/
+
+static int merge_queue_cmp(void* __arg, unsigned char* __a, unsigned char* __b)
+{
+    my_merge* merge = (my_merge*) __arg;
+    my_merge_cursor* a = (my_merge_cursor*) __a;
+    my_merge_cursor* b = (my_merge_cursor*) __b;
+    int cmp;
+
+    if (a == b)
+        return 0;
+    if ((cmp = merge->cmp(merge->cmp_arg, CURSOR_RECORD(merge, a, a->pos), CURSOR_RECORD(merge, b, b->pos))))
+        return cmp;
+    return a->idx < b->idx ? -1 : 1;
+}
+
+
+/*
+  Create a merge
+
+  SYNOPSIS
+    my_merge_init()
+      size	Size of a record
+      cmp	Compare function of the records, the runs are sorted by it
+      arg	First argument of cmp
+      max_runs	Largest number of runs
+
+  RETURN VALUE
+    pointer	Ok, free it with my_merge_uninit() and my_free()
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API my_merge* my_merge_init(size_t __size, qsort_cmp2 __cmp, const void* __arg, unsigned int __max_runs)
+{
+    my_merge* merge;
+
+    if (!(merge = my_malloc_padded_ex(sizeof(my_merge), MY_MEM_QUEUE)))
+        return NULL;
+    memset(merge, 0, sizeof(my_merge));
+    merge->size = __size;
+    merge->cmp = __cmp;
+    merge->cmp_arg = __arg;
+    merge->max_runs = __max_runs;
+    if (!(merge->cursors = (my_merge_cursor*) my_malloc_ex(MAX(__max_runs, 1) * sizeof(my_merge_cursor),
+                                                           MY_MEM_QUEUE)))
+        goto err;
+    if (queue_init(&merge->queue, __max_runs, 0, FALSE, merge_queue_cmp, merge))
+        goto err;
+    return merge;
+
+err:
+    my_free(merge->cursors);
+    my_free(merge);
+    return NULL;
+}
+
+
+/*
+  Free the buffers of the merge, the files of file runs stay open
+*/
+
+MY_GLOBAL_API void my_merge_uninit(my_merge* __merge)
+{
+    unsigned int i;
+
+    for (i = 0; i < __merge->runs; i++)
+    {
+        if (__merge->cursors[i].capacity)
+            my_free(__merge->cursors[i].buffer);
+    }
+    queue_delete(&__merge->queue);
+    my_free(__merge->cursors);
+    __merge->cursors = NULL;
+    __merge->runs = 0;
+}
+
+
+static my_merge_cursor* merge_new_cursor(my_merge* __merge, size_t __buffer_size)
+{
+    my_merge_cursor* cursor;
+
+    if (__merge->started || __merge->runs == __merge->max_runs)
+        return NULL;
+    cursor = &__merge->cursors[__merge->runs];
+    memset(cursor, 0, sizeof(my_merge_cursor));
+    cursor->idx = __merge->runs;
+    cursor->fd = -1;
+    if (__buffer_size)
+    {
+        cursor->capacity = MAX(__buffer_size / __merge->size, 1);
+        if (!(cursor->buffer = (unsigned char*) my_malloc_ex(cursor->capacity * __merge->size, MY_MEM_QUEUE)))
+            return NULL;
+    }
+    __merge->runs++;
+    return cursor;
+}
+
+
+/*
+  Add a sorted array of count records
+
+  RETURN VALUE
+    0	Ok
+    1	Too many runs, or the merge started
+*/
+
+MY_GLOBAL_API int my_merge_add_memory(my_merge* __merge, const void* __base, size_t __count)
+{
+    my_merge_cursor* cursor;
+
+    if (!(cursor = merge_new_cursor(__merge, 0)))
+        return 1;
+    cursor->buffer = (unsigned char*) __base;
+    cursor->count = __count;
+    return 0;
+}
+
+
+/*
+  Add a sorted run of count records stored in a file
+
+  SYNOPSIS
+    my_merge_add_file()
+      merge
+      fd		File, read with pread(), it is not closed
+      offset		Offset of the first record
+      count		Records in the run
+      buffer_size	Bytes read at once, 0 for MY_MERGE_BUFFER_SIZE
+
+  RETURN VALUE
+    0	Ok
+    1	Out of memory, too many runs, or the merge started
+*/
+
+MY_GLOBAL_API int my_merge_add_file(my_merge* __merge, int __fd, unsigned long long __offset,
+                                    unsigned long long __count, size_t __buffer_size)
+{
+    my_merge_cursor* cursor;
+
+    if (!(cursor = merge_new_cursor(__merge, __buffer_size ? __buffer_size : MY_MERGE_BUFFER_SIZE)))
+        return 1;
+    cursor->fd = __fd;
+    cursor->offset = __offset;
+    cursor->remaining = __count;
+    return 0;
+}
+
+
+/*
+  Add a sorted run produced by a read function, see my_merge_read_func
+
+  RETURN VALUE
+    0	Ok
+    1	Out of memory, too many runs, or the merge started
+*/
+
+MY_GLOBAL_API int my_merge_add_reader(my_merge* __merge, my_merge_read_func __read, void* __arg,
+                                      size_t __buffer_size)
+{
+    my_merge_cursor* cursor;
+
+    if (!(cursor = merge_new_cursor(__merge, __buffer_size ? __buffer_size : MY_MERGE_BUFFER_SIZE)))
+        return 1;
+    cursor->read = __read;
+    cursor->read_arg = __arg;
+    return 0;
+}
+
+
+/*
+  Read length bytes at offset, FALSE if they could not all be read
+*/
+
+static bool merge_pread(int __fd, unsigned char* __buffer, size_t __length, unsigned long long __offset)
+{
+#if defined(_WIN32)
+    int done;
+
+    if (_lseeki64(__fd, (__int64) __offset, SEEK_SET) < 0)
+        return FALSE;
+    for (; __length; __length -= (size_t) done, __buffer += done)
+    {
+        if ((done = _read(__fd, __buffer, (unsigned int) MIN(__length, 1U << 30))) <= 0)
+            return FALSE;
+    }
+#else
+    ssize_t done;
+
+    for (; __length; __length -= (size_t) done, __buffer += done, __offset += (size_t) done)
+    {
+        if ((done = pread(__fd, __buffer, __length, (off_t) __offset)) <= 0)
+            return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+
+/*
+  Read the next records of a run into its buffer
+
+  RETURN VALUE
+    TRUE	The buffer has records
+    FALSE	End of run, or error set
+*/
+
+static bool merge_fill(my_merge* __merge, my_merge_cursor* __cursor)
+{
+    size_t count;
+
+    __cursor->pos = 0;
+    __cursor->count = 0;
+    if (!__cursor->capacity)
+        return FALSE;
+    if (__cursor->read)
+    {
+        if ((count = __cursor->read(__cursor->read_arg, __cursor->buffer, __cursor->capacity)) ==
+            MY_MERGE_READ_ERROR)
+        {
+            __merge->error = 1;
+            return FALSE;
+        }
+        __cursor->count = MIN(count, __cursor->capacity);
+        return __cursor->count != 0;
+    }
+    if (!__cursor->remaining)
+        return FALSE;
+    count = (size_t) MIN(__cursor->remaining, (unsigned long long) __cursor->capacity);
+    if (!merge_pread(__cursor->fd, __cursor->buffer, count * __merge->size, __cursor->offset))
+    {
+        __merge->error = 1;
+        return FALSE;
+    }
+    __cursor->offset += count * __merge->size;
+    __cursor->remaining -= count;
+    __cursor->count = count;
+#if defined(POSIX_FADV_WILLNEED)
+    if (__cursor->remaining)
+        posix_fadvise(__cursor->fd, (off_t) __cursor->offset,
+                      (off_t) (MIN(__cursor->remaining, (unsigned long long) __cursor->capacity) * __merge->size),
+                      POSIX_FADV_WILLNEED);
+#endif
+    return TRUE;
+}
+
+
+/*
+  Fill every run and build the queue
+*/
+
+static bool merge_start(my_merge* __merge)
+{
+    unsigned int i;
+    my_merge_cursor* cursor;
+
+    __merge->started = TRUE;
+    for (i = 0; i < __merge->runs; i++)
+    {
+        cursor = &__merge->cursors[i];
+        if ((cursor->pos < cursor->count || merge_fill(__merge, cursor)))
+            queue_insert(&__merge->queue, (unsigned char*) cursor);
+        else if (__merge->error)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+
+/*
+  Move the top cursor past count records and restore the queue
+*/
+
+static bool merge_advance(my_merge* __merge, my_merge_cursor* __cursor, size_t __count)
+{
+    __cursor->pos += __count;
+    if (__cursor->pos < __cursor->count || merge_fill(__merge, __cursor))
+        queue_replaced(&__merge->queue);
+    else
+    {
+        queue_remove(&__merge->queue, 0);
+        if (__merge->error)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+
+/*
+  Next record of the merge
+
+  RETURN VALUE
+    pointer	The record, valid until the next call
+    NULL	End of the merge, or error, see my_merge_error()
+*/
+
+MY_GLOBAL_API const void* my_merge_next(my_merge* __merge)
+{
+    my_merge_cursor* cursor;
+
+    if (__merge->error)
+        return NULL;
+    if (!__merge->started)
+    {
+        if (!merge_start(__merge))
+            return NULL;
+    }
+    else if (__merge->last)
+    {
+        cursor = __merge->last;
+        __merge->last = NULL;
+        if (!merge_advance(__merge, cursor, 1))
+            return NULL;
+    }
+    if (!__merge->queue.elements)
+        return NULL;
+    __merge->last = cursor = (my_merge_cursor*) queue_top(&__merge->queue);
+    return CURSOR_RECORD(__merge, cursor, cursor->pos);
+}
+
+
+/*
+  Number of records of top, from pos and up to limit, that go before
+  the next record of next, found by galloping then binary search
+*/
+
+static size_t merge_run_length(my_merge* __merge, my_merge_cursor* __top, my_merge_cursor* __next,
+                               size_t __limit)
+{
+    const unsigned char* record = CURSOR_RECORD(__merge, __next, __next->pos);
+    int bound = __top->idx < __next->idx ? 0 : -1;   /* Equal records of top go first */
+    size_t lo = 1, hi = 2, mid;
+
+    /* Records pos .. pos + lo - 1 go before record */
+    while (hi < __limit &&
+           __merge->cmp(__merge->cmp_arg, CURSOR_RECORD(__merge, __top, __top->pos + hi - 1), record) <= bound)
+    {
+        lo = hi;
+        hi *= 2;
+    }
+    hi = MIN(hi, __limit);
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (__merge->cmp(__merge->cmp_arg, CURSOR_RECORD(__merge, __top, __top->pos + mid - 1), record) <= bound)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+
+/*
+  Copy the next records of the merge
+
+  SYNOPSIS
+    my_merge_next_batch()
+      merge
+      to	Array of count records
+      count	Largest number of records to copy
+
+  RETURN VALUE
+    Number of records copied, less than count only at the end of the
+    merge or on error, see my_merge_error()
+*/
+
+MY_GLOBAL_API size_t my_merge_next_batch(my_merge* __merge, void* __to, size_t __count)
+{
+    unsigned char* to = (unsigned char*) __to;
+    my_merge_cursor* cursor;
+    my_merge_cursor* next;
+    size_t done = 0, length;
+
+    if (!__count || !my_merge_next(__merge))
+        return 0;
+    __merge->last = NULL;       /* The record of my_merge_next() is copied below */
+    while (done < __count && __merge->queue.elements)
+    {
+        cursor = (my_merge_cursor*) queue_top(&__merge->queue);
+        length = MIN(cursor->count - cursor->pos, __count - done);
+        if (__merge->queue.elements > 1)
+        {
+            /* The best child of the top holds the next run */
+            next = (my_merge_cursor*) queue_element(&__merge->queue, 1);
+            if (__merge->queue.elements > 2 &&
+                merge_queue_cmp(__merge, (unsigned char*) queue_element(&__merge->queue, 2),
+                                (unsigned char*) next) < 0)
+                next = (my_merge_cursor*) queue_element(&__merge->queue, 2);
+            length = merge_run_length(__merge, cursor, next, length);
+        }
+        memcpy(to, CURSOR_RECORD(__merge, cursor, cursor->pos), length * __merge->size);
+        to += length * __merge->size;
+        done += length;
+        if (!merge_advance(__merge, cursor, length))
+            break;
+    }
+    return done;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Concurrent relaxed priority queue (MultiQueue).
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  With one lock around one heap every thread waits on the same lock and
+  cache line. Here each thread only touches the heaps it picks at random,
+  and a busy heap is passed over instead of waited for, so threads seldom
+  meet.
+
+  Picking the better top of two random heaps keeps the tops of all heaps
+  close to each other: on average the element returned is among the
+  first O(heaps) of the queue, and no element stays behind for long.
+*/
+
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_atomic.h"
+#include "my_pthread.h"
+#include "my_multi_queue.h"
+
+/* xorshift64* state of the thread, 0 until first used */
+static MY_THREAD_LOCAL unsigned long long multi_queue_seed;
+
+
+/*
+  Random heap number below count
+*/
+
+static unsigned int multi_queue_random(unsigned int __count)
+{
+    unsigned long long x = multi_queue_seed;
+
+    if (!x)
+    {
+        /* Every thread has its own seed, so its address differs */
+        x = ((unsigned long long) (size_t) &multi_queue_seed * 0x9E3779B97F4A7C15ULL) | 1;
+    }
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    multi_queue_seed = x;
+    return (unsigned int) (((x * 0x2545F4914F6CDD1DULL) >> 32) * __count >> 32);
+}
+
+
+/*
+  Take the lock of a heap if it is free, without waiting
+*/
+
+static bool multi_queue_trylock(my_multi_queue_heap* __heap)
+{
+    long long expected = 0;
+
+    /* Read first, a failed compare and swap still takes the line */
+    return !my_atomic_load(&__heap->lock) && my_atomic_cas(&__heap->lock, &expected, 1);
+}
+
+static void multi_queue_unlock(my_multi_queue_heap* __heap)
+{
+    my_atomic_store(&__heap->elements, (long long) __heap->queue.elements);
+    my_atomic_store_release(&__heap->lock, 0);
+}
+
+
+/*
+  Init a multi queue
+
+  SYNOPSIS
+    my_multi_queue_init()
+      queue		Queue to initialise
+      threads		Threads using the queue, it gets
+			MY_MULTI_QUEUE_FACTOR heaps per thread
+      max_elements	Max elements of each heap
+      offset_to_key	Offset to key in element stored in queue
+      max_at_top	Set to 1 if you want biggest element on top.
+      compare		Compare function for elements, takes 3 arguments.
+      first_cmp_arg	First argument to compare function
+      auto_extent	Growth of a full heap, 0 if it does not grow
+
+  NOTES
+    The compare function is called by many threads at once.
+
+  RETURN
+    0	ok
+    1	Could not allocate memory
+*/
+
+MY_GLOBAL_API int my_multi_queue_init(my_multi_queue* __queue, unsigned int __threads, unsigned int __max_elements,
+                                      unsigned int __offset_to_key, bool __max_at_top, queue_compare __compare,
+                                      void* __first_cmp_arg, unsigned int __auto_extent)
+{
+    unsigned int i;
+
+    __queue->count = MAX(__threads, 1) * MY_MULTI_QUEUE_FACTOR;
+    __queue->offset_to_key = __offset_to_key;
+    __queue->max_at_top = __max_at_top ? -1 : 1;
+    __queue->compare = __compare;
+    __queue->first_cmp_arg = __first_cmp_arg;
+    if (!(__queue->heaps = (my_multi_queue_heap*) my_malloc_padded_ex(__queue->count * sizeof(my_multi_queue_heap),
+                                                                      MY_MEM_QUEUE)))
+        return 1;
+    memset(__queue->heaps, 0, __queue->count * sizeof(my_multi_queue_heap));
+    for (i = 0; i < __queue->count; i++)
+    {
+        if (queue_init_ex(&__queue->heaps[i].queue, __max_elements, __offset_to_key, __max_at_top,
+                          __compare, __first_cmp_arg, __auto_extent))
+        {
+            while (i--)
+                queue_delete(&__queue->heaps[i].queue);
+            my_free(__queue->heaps);
+            __queue->heaps = NULL;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+  Free the heaps. No thread may use the queue any more.
+*/
+
+MY_GLOBAL_API void my_multi_queue_uninit(my_multi_queue* __queue)
+{
+    unsigned int i;
+
+    if (!__queue->heaps)
+        return;
+    for (i = 0; i < __queue->count; i++)
+        queue_delete(&__queue->heaps[i].queue);
+    my_free(__queue->heaps);
+    __queue->heaps = NULL;
+}
+
+
+/*
+  Insert an element in a random heap
+
+  RETURN
+    0	ok
+    1	Could not allocate memory
+    2	The heap is full and auto_extent is 0
+*/
+
+MY_GLOBAL_API int my_multi_queue_insert(my_multi_queue* __queue, unsigned char* __element)
+{
+    my_multi_queue_heap* heap;
+    int ret;
+
+    do
+        heap = &__queue->heaps[multi_queue_random(__queue->count)];
+    while (!multi_queue_trylock(heap));
+    ret = queue_insert_safe(&heap->queue, __element);
+    multi_queue_unlock(heap);
+    return ret;
+}
+
+
+/*
+  Remove the top of a heap locked by the caller, and unlock it
+*/
+
+static unsigned char* multi_queue_remove_top(my_multi_queue_heap* __heap)
+{
+    unsigned char* element = queue_remove(&__heap->queue, 0);
+
+    multi_queue_unlock(__heap);
+    return element;
+}
+
+
+/*
+  Remove the first element of any heap, waiting for busy heaps
+*/
+
+static unsigned char* multi_queue_scan(my_multi_queue* __queue)
+{
+    my_multi_queue_heap* heap;
+    unsigned int i, first = multi_queue_random(__queue->count);
+
+    for (i = 0; i < __queue->count; i++)
+    {
+        heap = &__queue->heaps[(first + i) % __queue->count];
+        if (!my_atomic_load(&heap->elements))
+            continue;
+        while (!multi_queue_trylock(heap))
+            continue;       /* Held only for one heap operation */
+        if (heap->queue.elements)
+            return multi_queue_remove_top(heap);
+        multi_queue_unlock(heap);
+    }
+    return NULL;
+}
+
+
+/*
+  Remove an element near the top of the queue
+
+  DESCRIPTION
+    Locks two random heaps and removes the better of their tops. Busy
+    or empty heaps are skipped; after MY_MULTI_QUEUE_TRIES picks every
+    heap is tried in turn.
+
+  RETURN
+    element	Removed element
+    NULL	Every heap was empty when it was tried
+*/
+
+MY_GLOBAL_API unsigned char* my_multi_queue_pop(my_multi_queue* __queue)
+{
+    my_multi_queue_heap *first, *second;
+    unsigned int tries;
+
+    for (tries = 0; tries < MY_MULTI_QUEUE_TRIES; tries++)
+    {
+        first = &__queue->heaps[multi_queue_random(__queue->count)];
+        second = &__queue->heaps[multi_queue_random(__queue->count)];
+        if (!my_atomic_load(&first->elements))
+        {
+            if (!my_atomic_load(&second->elements))
+                continue;
+            first = second;
+        }
+        if (!multi_queue_trylock(first))
+            continue;
+        if (second != first && my_atomic_load(&second->elements) && multi_queue_trylock(second))
+        {
+            if (!first->queue.elements ||
+                (second->queue.elements &&
+                 __queue->compare(__queue->first_cmp_arg,
+                                  queue_top(&second->queue) + __queue->offset_to_key,
+                                  queue_top(&first->queue) + __queue->offset_to_key) *
+                 __queue->max_at_top < 0))
+            {
+                multi_queue_unlock(first);
+                first = second;
+            }
+            else
+                multi_queue_unlock(second);
+        }
+        if (first->queue.elements)
+            return multi_queue_remove_top(first);
+        multi_queue_unlock(first);
+    }
+    return multi_queue_scan(__queue);
+}
+
+
+/*
+  Number of elements, not exact while other threads change the queue
+*/
+
+MY_GLOBAL_API unsigned long long my_multi_queue_elements(my_multi_queue* __queue)
+{
+    unsigned long long elements = 0;
+    unsigned int i;
+
+    for (i = 0; i < __queue->count; i++)
+        elements += (unsigned long long) my_atomic_load(&__queue->heaps[i].elements);
+    return elements;
+}
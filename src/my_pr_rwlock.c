@@ -14,6 +14,7 @@
 #include <assert.h>
 
 #include "my_pthread.h"
+#include "my_malloc.h"
 #include "my_pr_rwlock.h"
 
 MY_GLOBAL_API int rw_pr_init(rw_pr_lock_t* rwlock)
@@ -37,6 +38,33 @@ MY_GLOBAL_API int rw_pr_destroy(rw_pr_lock_t *rwlock)
 }
 
 
+/*
+  Allocate and initialize a lock on its own cache line
+
+  RETURN
+    pointer	ok, free it with rw_pr_free()
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API rw_pr_lock_t *rw_pr_alloc(void)
+{
+    rw_pr_lock_t *rwlock;
+
+    if ((rwlock = (rw_pr_lock_t*) my_malloc_padded(sizeof(rw_pr_lock_t))))
+        rw_pr_init(rwlock);
+    return rwlock;
+}
+
+
+MY_GLOBAL_API void rw_pr_free(rw_pr_lock_t *rwlock)
+{
+    if (!rwlock)
+        return;
+    rw_pr_destroy(rwlock);
+    my_free_aligned(rwlock);
+}
+
+
 MY_GLOBAL_API int rw_pr_rdlock(rw_pr_lock_t *rwlock)
 {
     pthread_mutex_lock(&rwlock->lock);
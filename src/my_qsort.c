@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Sorting.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  my_qsort() and my_qsort2() sort in place with pattern-defeating
+  quicksort (see my_qsort_impl.h). The algorithm is compiled twice for
+  each comparator type: once for any element size, and once for
+  pointer sized elements, where every element move is a single word.
+
+  my_qsort_parallel() cuts the array in one run per thread, sorts the
+  runs concurrently and merges them pairwise, each round of merges also
+  running in parallel, through a scratch buffer as big as the array.
+  Without memory for the scratch buffer it sorts in the calling thread.
+*/
+
+#include <string.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "my_global_exports.h"
+#include "my_pthread.h"
+#include "my_malloc.h"
+#include "my_bit.h"
+#include "my_qsort.h"
+
+#define PDQ_INSERTION_SORT  24  /* Ranges below this are insertion sorted */
+#define PDQ_NINTHER         128 /* Ranges above this use Tukey's ninther */
+#define PDQ_PARTIAL_LIMIT   8   /* Moves allowed to partial_insertion_sort */
+#define PDQ_STACK_BUFFER    256 /* Bigger elements use an allocated buffer */
+
+typedef struct st_pdq_context
+{
+    size_t size;
+    qsort_cmp cmp;
+    qsort_cmp2 cmp2;
+    const void* arg;
+    char* pivot;        /* One element, pivot or element being inserted */
+    char* swap;         /* One element, for swaps */
+} pdq_context;
+
+#define PDQ_NAME(N)         pdq_any_##N
+#define PDQ_SIZE(C)         ((C)->size)
+#define PDQ_LESS(C, A, B)   ((*(C)->cmp)((A), (B)) < 0)
+#include "my_qsort_impl.h"
+
+#define PDQ_NAME(N)         pdq_ptr_##N
+#define PDQ_SIZE(C)         sizeof(void*)
+#define PDQ_LESS(C, A, B)   ((*(C)->cmp)((A), (B)) < 0)
+#include "my_qsort_impl.h"
+
+#define PDQ_NAME(N)         pdq_any2_##N
+#define PDQ_SIZE(C)         ((C)->size)
+#define PDQ_LESS(C, A, B)   ((*(C)->cmp2)((C)->arg, (A), (B)) < 0)
+#include "my_qsort_impl.h"
+
+#define PDQ_NAME(N)         pdq_ptr2_##N
+#define PDQ_SIZE(C)         sizeof(void*)
+#define PDQ_LESS(C, A, B)   ((*(C)->cmp2)((C)->arg, (A), (B)) < 0)
+#include "my_qsort_impl.h"
+
+
+/*
+  Sort with either comparator
+
+  RETURN
+    0	ok
+    1	Out of memory for the element buffers, only possible for
+        elements bigger than PDQ_STACK_BUFFER / 2 bytes
+*/
+
+static int pdq_sort(void* __base, size_t __total, size_t __size,
+                    qsort_cmp __cmp, qsort_cmp2 __cmp2, const void* __arg)
+{
+    pdq_context ctx;
+    char buffer[PDQ_STACK_BUFFER];
+    char* elements = buffer;
+
+    if (__total < 2 || !__size)
+        return 0;
+    if (__size * 2 > sizeof(buffer) &&
+        !(elements = (char*) my_malloc(__size * 2)))
+        return 1;
+    ctx.size = __size;
+    ctx.cmp = __cmp;
+    ctx.cmp2 = __cmp2;
+    ctx.arg = __arg;
+    ctx.pivot = elements;
+    ctx.swap = elements + __size;
+
+    if (__size == sizeof(void*) && !((size_t) __base % sizeof(void*)))
+    {
+        if (__cmp)
+            pdq_ptr_sort(&ctx, (char*) __base, __total);
+        else
+            pdq_ptr2_sort(&ctx, (char*) __base, __total);
+    }
+    else if (__cmp)
+        pdq_any_sort(&ctx, (char*) __base, __total);
+    else
+        pdq_any2_sort(&ctx, (char*) __base, __total);
+
+    if (elements != buffer)
+        my_free(elements);
+    return 0;
+}
+
+
+/*
+  Sort an array
+
+  SYNOPSIS
+    my_qsort()
+      base	First element
+      total	Number of elements
+      size	Size of an element
+      cmp	Compare function
+
+  NOTES
+    The sort is not stable. Sorted, reverse sorted and mostly equal
+    inputs take linear time, the worst case is O(n log n).
+
+  RETURN
+    0	ok
+    1	Out of memory, only for elements over 128 bytes
+*/
+
+MY_GLOBAL_API int my_qsort(void* __base, size_t __total, size_t __size, qsort_cmp __cmp)
+{
+    return pdq_sort(__base, __total, __size, __cmp, NULL, NULL);
+}
+
+
+/*
+  Same as my_qsort(), the compare function gets arg as first argument
+*/
+
+MY_GLOBAL_API int my_qsort2(void* __base, size_t __total, size_t __size, qsort_cmp2 __cmp, const void* __arg)
+{
+    return pdq_sort(__base, __total, __size, NULL, __cmp, __arg);
+}
+
+
+/*
+  Parallel sort
+*/
+
+typedef struct st_qsort_job
+{
+    char* from;         /* Sort: the run. Merge: the first of two runs */
+    size_t left;        /* Elements in the first run */
+    size_t right;       /* Elements in the second run, follows the first */
+    char* to;           /* Merge destination */
+    size_t size;
+    qsort_cmp2 cmp;
+    const void* arg;
+    int error;
+} qsort_job;
+
+
+static void* qsort_sort_job(void* arg)
+{
+    qsort_job* job = (qsort_job*) arg;
+
+    job->error = my_qsort2(job->from, job->left, job->size, job->cmp, job->arg);
+    return NULL;
+}
+
+
+static void* qsort_merge_job(void* arg)
+{
+    qsort_job* job = (qsort_job*) arg;
+    size_t size = job->size;
+    char* a = job->from;
+    char* a_end = a + job->left * size;
+    char* b = a_end;
+    char* b_end = b + job->right * size;
+    char* to = job->to;
+
+    /* Take from the first run on ties, which keeps the merge stable */
+    while (a < a_end && b < b_end)
+    {
+        if ((*job->cmp)(job->arg, b, a) < 0)
+        {
+            memcpy(to, b, size);
+            b += size;
+        }
+        else
+        {
+            memcpy(to, a, size);
+            a += size;
+        }
+        to += size;
+    }
+    memcpy(to, a, (size_t) (a_end - a));
+    to += a_end - a;
+    memcpy(to, b, (size_t) (b_end - b));
+    return NULL;
+}
+
+
+/*
+  Run jobs, one per thread. The calling thread runs the first job, jobs
+  for which no thread could be created run in the calling thread too.
+*/
+
+static void qsort_run_jobs(qsort_job* jobs, unsigned int count, void* (*func)(void*))
+{
+    pthread_t threads[MY_QSORT_MAX_THREADS];
+    int started[MY_QSORT_MAX_THREADS];
+    unsigned int idx;
+
+    for (idx = 1; idx < count; idx++)
+        started[idx] = !pthread_create(&threads[idx], NULL, func, jobs + idx);
+    (*func)(jobs);
+    for (idx = 1; idx < count; idx++)
+    {
+        if (started[idx])
+            pthread_join(threads[idx], NULL);
+        else
+            (*func)(jobs + idx);
+    }
+}
+
+
+static unsigned int qsort_cpus(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned int) info.dwNumberOfProcessors;
+#else
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (unsigned int) cpus : 1;
+#endif
+}
+
+
+/*
+  Sort an array using several threads
+
+  SYNOPSIS
+    my_qsort_parallel()
+      base	First element
+      total	Number of elements
+      size	Size of an element
+      cmp	Compare function, called concurrently
+      arg	First argument of cmp
+      threads	Number of threads, 0 for one per online CPU
+
+  NOTES
+    Needs a scratch buffer of total * size bytes. Inputs smaller than
+    MY_QSORT_PARALLEL_MIN elements, or when the buffer can not be
+    allocated, are sorted by the calling thread.
+
+  RETURN
+    0	ok
+    1	Out of memory, only for elements over 128 bytes
+*/
+
+MY_GLOBAL_API int my_qsort_parallel(void* __base, size_t __total, size_t __size, qsort_cmp2 __cmp,
+                                    const void* __arg, unsigned int __threads)
+{
+    qsort_job jobs[MY_QSORT_MAX_THREADS];
+    size_t bounds[MY_QSORT_MAX_THREADS + 1];
+    unsigned int runs, idx, pairs;
+    char* scratch;
+    char* from;
+    char* to;
+    char* swap;
+    int error = 0;
+
+    if (!__threads)
+        __threads = qsort_cpus();
+    __threads = MIN(__threads, MY_QSORT_MAX_THREADS);
+    if (__threads < 2 || __total < MY_QSORT_PARALLEL_MIN ||
+        !(scratch = (char*) my_malloc(__total * __size)))
+        return my_qsort2(__base, __total, __size, __cmp, __arg);
+
+    /* Sort one run per thread */
+    runs = __threads;
+    for (idx = 0; idx <= runs; idx++)
+        bounds[idx] = __total / runs * idx + MIN(idx, __total % runs);
+    for (idx = 0; idx < runs; idx++)
+    {
+        jobs[idx].from = (char*) __base + bounds[idx] * __size;
+        jobs[idx].left = bounds[idx + 1] - bounds[idx];
+        jobs[idx].size = __size;
+        jobs[idx].cmp = __cmp;
+        jobs[idx].arg = __arg;
+        jobs[idx].error = 0;
+    }
+    qsort_run_jobs(jobs, runs, qsort_sort_job);
+    for (idx = 0; idx < runs; idx++)
+        error |= jobs[idx].error;
+
+    /* Merge pairs of runs until one is left */
+    from = (char*) __base;
+    to = scratch;
+    while (runs > 1)
+    {
+        pairs = runs / 2;
+        for (idx = 0; idx < pairs; idx++)
+        {
+            jobs[idx].from = from + bounds[2 * idx] * __size;
+            jobs[idx].left = bounds[2 * idx + 1] - bounds[2 * idx];
+            jobs[idx].right = bounds[2 * idx + 2] - bounds[2 * idx + 1];
+            jobs[idx].to = to + bounds[2 * idx] * __size;
+        }
+        qsort_run_jobs(jobs, pairs, qsort_merge_job);
+        if (runs & 1)
+            memcpy(to + bounds[runs - 1] * __size, from + bounds[runs - 1] * __size,
+                   (bounds[runs] - bounds[runs - 1]) * __size);
+        for (idx = 1; idx <= pairs; idx++)
+            bounds[idx] = bounds[2 * idx];
+        if (runs & 1)
+            bounds[pairs + 1] = bounds[runs];
+        runs -= pairs;
+        swap = from; from = to; to = swap;
+    }
+    if (from != (char*) __base)
+        memcpy(__base, from, __total * __size);
+    my_free(scratch);
+    return error;
+}
+
+
+/*
+  Radix sorts
+
+  The integer sorts are LSD radix sorts on 8 bit digits: one pass counts
+  all digits, then every digit for which the keys differ costs one
+  stable scatter of the elements between the array and the scratch
+  buffer. There is no comparison and no function call per element.
+
+  The byte string sort is a MSD radix sort: elements are scattered on
+  the first byte, each bucket is then sorted on the next byte, buckets
+  smaller than MY_RADIX_INSERTION_SORT are finished by insertion sort.
+*/
+
+#define RADIX_BITS      8
+#define RADIX_BUCKETS   (1 << RADIX_BITS)
+
+static inline void radix_copy(char* to, const char* from, size_t size)
+{
+    /* Let the compiler move the common sizes with plain loads and stores */
+    switch (size) {
+    case 4:
+        memcpy(to, from, 4);
+        break;
+    case 8:
+        memcpy(to, from, 8);
+        break;
+    case 16:
+        memcpy(to, from, 16);
+        break;
+    default:
+        memcpy(to, from, size);
+    }
+}
+
+
+static inline unsigned long long radix_key(const char* element, unsigned int width,
+                                           unsigned long long flip)
+{
+    unsigned int key32;
+    unsigned long long key64;
+
+    if (width == 4)
+    {
+        memcpy(&key32, element, 4);
+        return key32 ^ flip;
+    }
+    memcpy(&key64, element, 8);
+    return key64 ^ flip;
+}
+
+
+static int radix_sort_lsd(char* base, size_t total, size_t size, size_t offset,
+                          unsigned int width, unsigned int flags, char* scratch)
+{
+    size_t counts[8][RADIX_BUCKETS];
+    size_t sum, count;
+    unsigned long long flip = 0;
+    unsigned int digit, shift, bucket;
+    char* from = base;
+    char* to;
+    char* end;
+    char* element;
+    char* swap;
+    char* allocated = NULL;
+
+    if (total < 2)
+        return 0;
+    if (!scratch && !(scratch = allocated = (char*) my_malloc(total * size)))
+        return 1;
+    /* Map keys to unsigned values in the wanted order */
+    if (flags & MY_RADIX_SIGNED)
+        flip = 1ULL << (width * 8 - 1);
+    if (flags & MY_RADIX_DESC)
+        flip ^= width == 4 ? 0xFFFFFFFFULL : ~0ULL;
+
+    memset(counts, 0, sizeof(counts));
+    end = base + total * size;
+    for (element = base; element < end; element += size)
+    {
+        unsigned long long key = radix_key(element + offset, width, flip);
+        for (digit = 0; digit < width; digit++)
+            counts[digit][(key >> (digit * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+    }
+
+    to = scratch;
+    for (digit = 0; digit < width; digit++)
+    {
+        shift = digit * RADIX_BITS;
+        /* All keys share this digit, the pass would not move anything */
+        if (counts[digit][(radix_key(from + offset, width, flip) >> shift) & (RADIX_BUCKETS - 1)] == total)
+            continue;
+        for (sum = 0, bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+        {
+            count = counts[digit][bucket];
+            counts[digit][bucket] = sum;
+            sum += count;
+        }
+        end = from + total * size;
+        for (element = from; element < end; element += size)
+        {
+            bucket = (unsigned int) (radix_key(element + offset, width, flip) >> shift) & (RADIX_BUCKETS - 1);
+            radix_copy(to + counts[digit][bucket]++ * size, element, size);
+        }
+        swap = from; from = to; to = swap;
+    }
+    if (from != base)
+        memcpy(base, from, total * size);
+    my_free(allocated);
+    return 0;
+}
+
+
+/*
+  Sort elements on an unsigned 32 bit key
+
+  SYNOPSIS
+    my_radix_sort_u32()
+      base	First element
+      total	Number of elements
+      size	Size of an element
+      offset	Offset of the key in the element, in host byte order
+      flags	MY_RADIX_SIGNED, MY_RADIX_DESC
+      scratch	Buffer of total * size bytes, NULL to allocate one
+
+  NOTES
+    The sort is stable. It takes one counting pass and at most four
+    scatter passes, whatever the distribution of the keys.
+
+  RETURN
+    0	ok
+    1	Out of memory, the array is unchanged
+*/
+
+MY_GLOBAL_API int my_radix_sort_u32(void* __base, size_t __total, size_t __size, size_t __offset,
+                                    unsigned int __flags, void* __scratch)
+{
+    return radix_sort_lsd((char*) __base, __total, __size, __offset, 4, __flags, (char*) __scratch);
+}
+
+
+/*
+  Same as my_radix_sort_u32() on a 64 bit key, at most eight scatter passes
+*/
+
+MY_GLOBAL_API int my_radix_sort_u64(void* __base, size_t __total, size_t __size, size_t __offset,
+                                    unsigned int __flags, void* __scratch)
+{
+    return radix_sort_lsd((char*) __base, __total, __size, __offset, 8, __flags, (char*) __scratch);
+}
+
+
+static void radix_sort_msd(char* base, char* scratch, size_t total, size_t size,
+                           size_t offset, size_t length, size_t depth)
+{
+    size_t counts[RADIX_BUCKETS];
+    size_t idx, sum, count;
+    unsigned int bucket;
+    char* element;
+    char* sift;
+
+    for (;;)
+    {
+        if (total < MY_RADIX_INSERTION_SORT)
+        {
+            /* The scratch area of the bucket is free, it holds the element moved */
+            for (idx = 1; idx < total; idx++)
+            {
+                element = base + idx * size;
+                if (memcmp(element - size + offset + depth, element + offset + depth, length - depth) <= 0)
+                    continue;
+                memcpy(scratch, element, size);
+                for (sift = element; sift > base &&
+                     memcmp(sift - size + offset + depth, scratch + offset + depth, length - depth) > 0;
+                     sift -= size)
+                    memcpy(sift, sift - size, size);
+                memcpy(sift, scratch, size);
+            }
+            return;
+        }
+
+        memset(counts, 0, sizeof(counts));
+        for (idx = 0; idx < total; idx++)
+            counts[(unsigned char) base[idx * size + offset + depth]]++;
+        bucket = (unsigned char) base[offset + depth];
+        if (counts[bucket] == total)
+        {
+            /* Common prefix, go to the next byte without moving anything */
+            if (++depth == length)
+                return;
+            continue;
+        }
+        break;
+    }
+
+    for (sum = 0, bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+    {
+        count = counts[bucket];
+        counts[bucket] = sum;
+        sum += count;
+    }
+    for (idx = 0; idx < total; idx++)
+    {
+        element = base + idx * size;
+        radix_copy(scratch + counts[(unsigned char) element[offset + depth]]++ * size, element, size);
+    }
+    memcpy(base, scratch, total * size);
+    if (++depth == length)
+        return;
+    /* counts[bucket] is now the end of bucket */
+    for (sum = 0, bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+    {
+        if ((count = counts[bucket] - sum) > 1)
+            radix_sort_msd(base + sum * size, scratch + sum * size, count, size, offset, length, depth);
+        sum = counts[bucket];
+    }
+}
+
+
+/*
+  Sort elements on a fixed length byte string key
+
+  SYNOPSIS
+    my_radix_sort_bytes()
+      base	First element
+      total	Number of elements
+      size	Size of an element
+      offset	Offset of the key in the element
+      length	Length of the key, keys are compared like memcmp()
+      scratch	Buffer of total * size bytes, NULL to allocate one
+
+  NOTES
+    Not stable. Recursion depth is at most length, bytes shared by all
+    keys of a bucket cost one counting pass and no move.
+
+  RETURN
+    0	ok
+    1	Out of memory, the array is unchanged
+*/
+
+MY_GLOBAL_API int my_radix_sort_bytes(void* __base, size_t __total, size_t __size, size_t __offset,
+                                      size_t __length, void* __scratch)
+{
+    char* allocated = NULL;
+
+    if (__total < 2 || !__length)
+        return 0;
+    if (!__scratch && !(__scratch = allocated = (char*) my_malloc(__total * __size)))
+        return 1;
+    radix_sort_msd((char*) __base, (char*) __scratch, __total, __size, __offset, __length, 0);
+    my_free(allocated);
+    return 0;
+}
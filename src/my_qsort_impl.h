@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Pattern-defeating quicksort, included by my_qsort.c once per variant.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  The includer defines:
+
+    PDQ_NAME(N)		Prefix for the generated functions
+    PDQ_SIZE(C)		Element size, a constant when possible so that
+                        copies compile to plain loads and stores
+    PDQ_LESS(C, A, B)	Non zero if element A sorts before element B
+
+  C is the pdq_context of the sort. All functions work on byte pointers,
+  end pointing past the last element.
+
+  The algorithm is Orson Peters' pdqsort: introsort with median of 3 (or
+  Tukey's ninther) pivots, a partition that puts elements equal to the
+  pivot on the left when the pivot equals its predecessor, so inputs
+  with many duplicates sort in linear time, partial insertion sort for
+  runs that are already partitioned, and shuffling plus a heapsort
+  fallback when partitions are repeatedly unbalanced.
+*/
+
+#define ES PDQ_SIZE(ctx)
+
+static inline void PDQ_NAME(swap)(pdq_context* ctx, char* a, char* b)
+{
+    memcpy(ctx->swap, a, ES);
+    memcpy(a, b, ES);
+    memcpy(b, ctx->swap, ES);
+}
+
+
+static inline void PDQ_NAME(sort2)(pdq_context* ctx, char* a, char* b)
+{
+    if (PDQ_LESS(ctx, b, a))
+        PDQ_NAME(swap)(ctx, a, b);
+}
+
+
+static inline void PDQ_NAME(sort3)(pdq_context* ctx, char* a, char* b, char* c)
+{
+    PDQ_NAME(sort2)(ctx, a, b);
+    PDQ_NAME(sort2)(ctx, b, c);
+    PDQ_NAME(sort2)(ctx, a, b);
+}
+
+
+static void PDQ_NAME(insertion_sort)(pdq_context* ctx, char* begin, char* end)
+{
+    char* cur;
+    char* sift;
+
+    if (begin == end)
+        return;
+    for (cur = begin + ES; cur < end; cur += ES)
+    {
+        if (!PDQ_LESS(ctx, cur, cur - ES))
+            continue;
+        memcpy(ctx->pivot, cur, ES);
+        sift = cur;
+        do
+        {
+            memcpy(sift, sift - ES, ES);
+            sift -= ES;
+        } while (sift != begin && PDQ_LESS(ctx, ctx->pivot, sift - ES));
+        memcpy(sift, ctx->pivot, ES);
+    }
+}
+
+
+/* Insertion sort knowing that begin[-1] is not above any element */
+
+static void PDQ_NAME(unguarded_insertion_sort)(pdq_context* ctx, char* begin, char* end)
+{
+    char* cur;
+    char* sift;
+
+    for (cur = begin + ES; cur < end; cur += ES)
+    {
+        if (!PDQ_LESS(ctx, cur, cur - ES))
+            continue;
+        memcpy(ctx->pivot, cur, ES);
+        sift = cur;
+        do
+        {
+            memcpy(sift, sift - ES, ES);
+            sift -= ES;
+        } while (PDQ_LESS(ctx, ctx->pivot, sift - ES));
+        memcpy(sift, ctx->pivot, ES);
+    }
+}
+
+
+/*
+  Insertion sort giving up after PDQ_PARTIAL_LIMIT moved elements.
+  Returns 1 if the range got sorted.
+*/
+
+static int PDQ_NAME(partial_insertion_sort)(pdq_context* ctx, char* begin, char* end)
+{
+    char* cur;
+    char* sift;
+    size_t moved = 0;
+
+    if (begin == end)
+        return 1;
+    for (cur = begin + ES; cur < end; cur += ES)
+    {
+        if (!PDQ_LESS(ctx, cur, cur - ES))
+            continue;
+        memcpy(ctx->pivot, cur, ES);
+        sift = cur;
+        do
+        {
+            memcpy(sift, sift - ES, ES);
+            sift -= ES;
+        } while (sift != begin && PDQ_LESS(ctx, ctx->pivot, sift - ES));
+        memcpy(sift, ctx->pivot, ES);
+        moved += (size_t) (cur - sift) / ES;
+        if (moved > PDQ_PARTIAL_LIMIT)
+            return 0;
+    }
+    return 1;
+}
+
+
+static void PDQ_NAME(sift_down)(pdq_context* ctx, char* base, size_t idx, size_t total)
+{
+    size_t child;
+
+    for (;;)
+    {
+        if ((child = 2 * idx + 1) >= total)
+            return;
+        if (child + 1 < total && PDQ_LESS(ctx, base + child * ES, base + (child + 1) * ES))
+            child++;
+        if (!PDQ_LESS(ctx, base + idx * ES, base + child * ES))
+            return;
+        PDQ_NAME(swap)(ctx, base + idx * ES, base + child * ES);
+        idx = child;
+    }
+}
+
+
+static void PDQ_NAME(heap_sort)(pdq_context* ctx, char* begin, char* end)
+{
+    size_t total = (size_t) (end - begin) / ES;
+    size_t idx;
+
+    for (idx = total / 2; idx-- > 0; )
+        PDQ_NAME(sift_down)(ctx, begin, idx, total);
+    while (total > 1)
+    {
+        total--;
+        PDQ_NAME(swap)(ctx, begin, begin + total * ES);
+        PDQ_NAME(sift_down)(ctx, begin, 0, total);
+    }
+}
+
+
+/*
+  Partition around the pivot in *begin, elements equal to the pivot go
+  to the right. Returns the final position of the pivot and sets
+  *partitioned if no element had to be swapped.
+*/
+
+static char* PDQ_NAME(partition_right)(pdq_context* ctx, char* begin, char* end, int* partitioned)
+{
+    char* first = begin;
+    char* last = end;
+    char* pivot_pos;
+
+    memcpy(ctx->pivot, begin, ES);
+    /* The median of 3 guarantees an element not below the pivot */
+    while (PDQ_LESS(ctx, first += ES, ctx->pivot))
+        ;
+    if (first - ES == begin)
+        while (first < last && !PDQ_LESS(ctx, last -= ES, ctx->pivot))
+            ;
+    else
+        while (!PDQ_LESS(ctx, last -= ES, ctx->pivot))
+            ;
+    *partitioned = first >= last;
+    while (first < last)
+    {
+        PDQ_NAME(swap)(ctx, first, last);
+        while (PDQ_LESS(ctx, first += ES, ctx->pivot))
+            ;
+        while (!PDQ_LESS(ctx, last -= ES, ctx->pivot))
+            ;
+    }
+    pivot_pos = first - ES;
+    memcpy(begin, pivot_pos, ES);
+    memcpy(pivot_pos, ctx->pivot, ES);
+    return pivot_pos;
+}
+
+
+/*
+  Partition around the pivot in *begin, elements equal to the pivot go
+  to the left. Used when the pivot equals the element before the range:
+  everything left of the returned position equals the pivot and needs
+  no more sorting.
+*/
+
+static char* PDQ_NAME(partition_left)(pdq_context* ctx, char* begin, char* end)
+{
+    char* first = begin;
+    char* last = end;
+    char* pivot_pos;
+
+    memcpy(ctx->pivot, begin, ES);
+    while (PDQ_LESS(ctx, ctx->pivot, last -= ES))
+        ;
+    if (last + ES == end)
+        while (first < last && !PDQ_LESS(ctx, ctx->pivot, first += ES))
+            ;
+    else
+        while (!PDQ_LESS(ctx, ctx->pivot, first += ES))
+            ;
+    while (first < last)
+    {
+        PDQ_NAME(swap)(ctx, first, last);
+        while (PDQ_LESS(ctx, ctx->pivot, last -= ES))
+            ;
+        while (!PDQ_LESS(ctx, ctx->pivot, first += ES))
+            ;
+    }
+    pivot_pos = last;
+    memcpy(begin, pivot_pos, ES);
+    memcpy(pivot_pos, ctx->pivot, ES);
+    return pivot_pos;
+}
+
+
+static void PDQ_NAME(loop)(pdq_context* ctx, char* begin, char* end, int bad_allowed, int leftmost)
+{
+    size_t total, half, l_size, r_size;
+    char* pivot_pos;
+    int partitioned;
+
+    for (;;)
+    {
+        total = (size_t) (end - begin) / ES;
+        if (total < PDQ_INSERTION_SORT)
+        {
+            if (leftmost)
+                PDQ_NAME(insertion_sort)(ctx, begin, end);
+            else
+                PDQ_NAME(unguarded_insertion_sort)(ctx, begin, end);
+            return;
+        }
+
+        /* Move the pivot to *begin */
+        half = total / 2;
+        if (total > PDQ_NINTHER)
+        {
+            PDQ_NAME(sort3)(ctx, begin, begin + half * ES, end - ES);
+            PDQ_NAME(sort3)(ctx, begin + ES, begin + (half - 1) * ES, end - 2 * ES);
+            PDQ_NAME(sort3)(ctx, begin + 2 * ES, begin + (half + 1) * ES, end - 3 * ES);
+            PDQ_NAME(sort3)(ctx, begin + (half - 1) * ES, begin + half * ES, begin + (half + 1) * ES);
+            PDQ_NAME(swap)(ctx, begin, begin + half * ES);
+        }
+        else
+            PDQ_NAME(sort3)(ctx, begin + half * ES, begin, end - ES);
+
+        /*
+          The pivot equals the element before the range, which is the
+          pivot of a previous partition: all elements equal to it can be
+          put aside at once.
+        */
+        if (!leftmost && !PDQ_LESS(ctx, begin - ES, begin))
+        {
+            begin = PDQ_NAME(partition_left)(ctx, begin, end) + ES;
+            continue;
+        }
+
+        pivot_pos = PDQ_NAME(partition_right)(ctx, begin, end, &partitioned);
+        l_size = (size_t) (pivot_pos - begin) / ES;
+        r_size = (size_t) (end - (pivot_pos + ES)) / ES;
+
+        if (l_size < total / 8 || r_size < total / 8)
+        {
+            /* Too many bad pivots, switch to heapsort for O(n log n) */
+            if (--bad_allowed == 0)
+            {
+                PDQ_NAME(heap_sort)(ctx, begin, end);
+                return;
+            }
+            /* Break patterns that fool the median selection */
+            if (l_size >= PDQ_INSERTION_SORT)
+            {
+                PDQ_NAME(swap)(ctx, begin, begin + (l_size / 4) * ES);
+                PDQ_NAME(swap)(ctx, pivot_pos - ES, pivot_pos - (l_size / 4) * ES);
+                if (l_size > PDQ_NINTHER)
+                {
+                    PDQ_NAME(swap)(ctx, begin + ES, begin + (l_size / 4 + 1) * ES);
+                    PDQ_NAME(swap)(ctx, begin + 2 * ES, begin + (l_size / 4 + 2) * ES);
+                    PDQ_NAME(swap)(ctx, pivot_pos - 2 * ES, pivot_pos - (l_size / 4 + 1) * ES);
+                    PDQ_NAME(swap)(ctx, pivot_pos - 3 * ES, pivot_pos - (l_size / 4 + 2) * ES);
+                }
+            }
+            if (r_size >= PDQ_INSERTION_SORT)
+            {
+                PDQ_NAME(swap)(ctx, pivot_pos + ES, pivot_pos + (1 + r_size / 4) * ES);
+                PDQ_NAME(swap)(ctx, end - ES, end - (r_size / 4) * ES);
+                if (r_size > PDQ_NINTHER)
+                {
+                    PDQ_NAME(swap)(ctx, pivot_pos + 2 * ES, pivot_pos + (2 + r_size / 4) * ES);
+                    PDQ_NAME(swap)(ctx, pivot_pos + 3 * ES, pivot_pos + (3 + r_size / 4) * ES);
+                    PDQ_NAME(swap)(ctx, end - 2 * ES, end - (1 + r_size / 4) * ES);
+                    PDQ_NAME(swap)(ctx, end - 3 * ES, end - (2 + r_size / 4) * ES);
+                }
+            }
+        }
+        else if (partitioned &&
+                 PDQ_NAME(partial_insertion_sort)(ctx, begin, pivot_pos) &&
+                 PDQ_NAME(partial_insertion_sort)(ctx, pivot_pos + ES, end))
+            return;
+
+        /* Recurse into the left part, loop on the right one */
+        PDQ_NAME(loop)(ctx, begin, pivot_pos, bad_allowed, leftmost);
+        begin = pivot_pos + ES;
+        leftmost = 0;
+    }
+}
+
+
+static void PDQ_NAME(sort)(pdq_context* ctx, char* begin, size_t total)
+{
+    if (total > 1)
+        PDQ_NAME(loop)(ctx, begin, begin + total * ES, (int) my_bit_log2_64(total) + 1, 1);
+}
+
+#undef ES
+#undef PDQ_NAME
+#undef PDQ_SIZE
+#undef PDQ_LESS
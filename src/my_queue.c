@@ -20,7 +20,84 @@
   of queue_fix was implemented.
 */
 
-#include "my_queues.h"
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include "my_bit.h"
+#include "my_malloc.h"
+#include "my_queue.h"
+
+/* Bytes before slot 0 in the allocated block, puts slot 2 on a cache line */
+#define QUEUE_SLOTS_OFFSET(size) (MY_CACHE_LINE_SIZE - 2 * (size))
+
+#define QUEUE_PARENT(queue, idx) \
+    (((idx) + queue_arity(queue) - 2) >> (queue)->arity_shift)
+#define QUEUE_FIRST_CHILD(queue, idx) ((((idx) - 1) << (queue)->arity_shift) + 2)
+
+#define QUEUE_SET_POSITION(queue, element, pos) \
+    (*(unsigned int*) ((element) + (queue)->offset_to_pos) = (pos))
+
+/* Key prefix of an element, of the element in slot idx */
+#define QUEUE_KEY(queue, element) \
+    ((queue)->keys ? (queue)->key_prefix((queue)->first_cmp_arg, (element) + (queue)->offset_to_key) : 0)
+#define QUEUE_SLOT_KEY(queue, idx) ((queue)->keys ? (queue)->keys[idx] : 0)
+
+/* Put element, with its key prefix, in slot idx and record its position */
+#define QUEUE_SET(queue, idx, element, key) \
+    do { \
+        (queue)->root[idx] = (element); \
+        if ((queue)->keys) \
+            (queue)->keys[idx] = (key); \
+        if ((queue)->indexed) \
+            QUEUE_SET_POSITION(queue, element, (idx) - 1); \
+    } while (0)
+#define QUEUE_MOVE(queue, to, from) \
+    QUEUE_SET(queue, to, (queue)->root[from], QUEUE_SLOT_KEY(queue, from))
+
+
+/*
+  Allocate or resize an array of max_elements + 1 slots of size bytes,
+  aligned so that slot 2, the first group of children, starts a cache
+  line
+*/
+
+static void* queue_alloc_slots(void* slots, unsigned int max_elements, size_t size)
+{
+    size_t length = (max_elements + 1) * size + QUEUE_SLOTS_OFFSET(size);
+    unsigned char* block;
+
+    if (slots)
+        block = (unsigned char*) my_realloc_ex((unsigned char*) slots - QUEUE_SLOTS_OFFSET(size),
+                                               length, MY_MEM_QUEUE);
+    else
+        block = (unsigned char*) my_malloc_aligned_ex(length, MY_CACHE_LINE_SIZE, MY_MEM_QUEUE);
+    return block ? block + QUEUE_SLOTS_OFFSET(size) : NULL;
+}
+
+static void queue_free_slots(void* slots, size_t size)
+{
+    if (slots)
+        my_free_aligned((unsigned char*) slots - QUEUE_SLOTS_OFFSET(size));
+}
+
+
+/*
+  Compare element a with key prefix a_key to element b
+
+  RETURN
+    < 0, 0 or > 0 as a goes before, with or after b in the queue,
+    max_at_top applied
+*/
+
+static inline int queue_cmp(my_queue* queue, unsigned char* a, unsigned long long a_key,
+                            unsigned char* b, unsigned long long b_key)
+{
+    if (a_key != b_key)
+        return a_key < b_key ? -queue->max_at_top : queue->max_at_top;
+    return queue->compare(queue->first_cmp_arg, a + queue->offset_to_key,
+                          b + queue->offset_to_key) * queue->max_at_top;
+}
 
 /*
   Init queue
@@ -46,13 +123,19 @@
 MY_GLOBAL_API int queue_init(my_queue* queue, unsigned int max_elements, unsigned int offset_to_key,
 	       bool max_at_top, int (*compare)(void*, unsigned char*, unsigned char*), void* first_cmp_arg)
 {
-    if (!(queue->root = (unsigned char **) my_malloc((max_elements+1)*sizeof(void*))))
+    if (!(queue->root = (unsigned char**) queue_alloc_slots(NULL, max_elements, sizeof(void*))))
       return 1;
+    queue->keys = NULL;
+    queue->key_prefix = NULL;
+    queue->offset_to_pos = 0;
+    queue->indexed = FALSE;
     queue->elements = 0;
     queue->compare = compare;
     queue->first_cmp_arg = first_cmp_arg;
     queue->max_elements = max_elements;
     queue->offset_to_key = offset_to_key;
+    queue->auto_extent = 0;
+    queue->arity_shift = 1;
     queue_set_max_at_top(queue, max_at_top);
 	
     return 0;
@@ -112,7 +195,9 @@ MY_GLOBAL_API int queue_init_ex(my_queue* queue, unsigned int max_elements, unsi
 
   NOTES
     This will delete all elements from the queue.  If you don't want this,
-    use queue_resize() instead.
+    use queue_resize() instead. The key prefixes are turned off, they
+    belong to the old compare function, and so is the indexed mode, the
+    position offset belongs to the old elements.
 
   RETURN
     0			ok
@@ -127,12 +212,46 @@ MY_GLOBAL_API int queue_reinit(my_queue* queue, unsigned int max_elements, unsig
     queue->first_cmp_arg = first_cmp_arg;
     queue->offset_to_key = offset_to_key;
     queue_set_max_at_top(queue, max_at_top);
+    queue_set_key_prefix(queue, NULL);
+    queue->indexed = FALSE;
+    queue->offset_to_pos = 0;
     queue_resize(queue, max_elements);
 	
     return 0;
 }
 
 
+/*
+  Set the number of children per node
+
+  SYNOPSIS
+    queue_set_arity()
+    queue		Queue
+    arity		2, 4, 8 or 16 children per node, 0 for MY_QUEUE_ARITY
+
+  NOTES
+    A wider heap has fewer levels, so fewer cache lines are touched by
+    queue_insert(), and the children compared by _downheap() are
+    contiguous. _downheap() does arity - 1 more comparisons per level.
+    The elements already in the queue are reordered with queue_fix().
+
+  RETURN
+    0	ok
+    1	arity is not a power of 2 up to MY_QUEUE_MAX_ARITY
+*/
+
+MY_GLOBAL_API int queue_set_arity(my_queue* queue, unsigned int arity)
+{
+    if (!arity)
+        arity = MY_QUEUE_ARITY;
+    if (arity < 2 || arity > MY_QUEUE_MAX_ARITY || (arity & (arity - 1)))
+        return 1;
+    queue->arity_shift = my_bit_log2(arity);
+    queue_fix(queue);
+    return 0;
+}
+
+
 /*
   Resize queue
 
@@ -153,12 +272,33 @@ MY_GLOBAL_API int queue_reinit(my_queue* queue, unsigned int max_elements, unsig
 MY_GLOBAL_API int queue_resize(my_queue* queue, unsigned int max_elements)
 {
     unsigned char** new_root;
+    unsigned long long* new_keys= NULL;
 	
     if (queue->max_elements == max_elements)
         return 0;
-    if (!(new_root= (unsigned char **) my_realloc((void *)queue->root, (max_elements+1)*sizeof(void*))))
+    /*
+      The keys go to a new buffer, freed if root cannot be resized, so
+      that both keep their size on failure
+    */
+    if (queue->keys)
+    {
+        if (!(new_keys= (unsigned long long*) queue_alloc_slots(NULL, max_elements,
+                                                               sizeof(unsigned long long))))
+            return 1;
+        memcpy(new_keys, queue->keys,
+               (MIN(queue->elements, max_elements) + 1) * sizeof(unsigned long long));
+    }
+    if (!(new_root= (unsigned char**) queue_alloc_slots(queue->root, max_elements, sizeof(void*))))
+    {
+        queue_free_slots(new_keys, sizeof(unsigned long long));
         return 1;
-    set_if_smaller(queue->elements, max_elements);
+    }
+    if (new_keys)
+    {
+        queue_free_slots(queue->keys, sizeof(unsigned long long));
+        queue->keys= new_keys;
+    }
+    queue->elements = MIN(queue->elements, max_elements);
     queue->max_elements = max_elements;
     queue->root= new_root;
 	
@@ -182,30 +322,39 @@ MY_GLOBAL_API int queue_resize(my_queue* queue, unsigned int max_elements)
 
 MY_GLOBAL_API void queue_delete(my_queue* queue)
 {
-    my_free(queue->root);
+    queue_free_slots(queue->root, sizeof(void*));
+    queue_free_slots(queue->keys, sizeof(unsigned long long));
     queue->root= NULL;
+    queue->keys= NULL;
 }
 
 
 	/* Code for insert, search and delete of elements */
 
-MY_GLOBAL_API void queue_insert(my_queue* queue, unsigned char* element)
+/*
+  Move element, with key prefix key, up from slot idx to its place
+*/
+
+static void queue_upheap(my_queue* queue, unsigned int idx, unsigned char* element,
+                         unsigned long long key)
 {
-    unsigned int idx, next;
-	
-    assert(queue->elements < queue->max_elements);
-    queue->root[0] = element;
-    idx = ++queue->elements;
+    unsigned int next;
+
     /* max_at_top swaps the comparison if we want to order by desc */
-    while ((queue->compare(queue->first_cmp_arg,
-                           element + queue->offset_to_key,
-                           queue->root[(next= idx >> 1)] +
-                           queue->offset_to_key) * queue->max_at_top) < 0)
+    while (idx > 1 &&
+           (next= QUEUE_PARENT(queue, idx),
+            queue_cmp(queue, element, key, queue->root[next], QUEUE_SLOT_KEY(queue, next))) < 0)
     {
-        queue->root[idx] = queue->root[next];
+        QUEUE_MOVE(queue, idx, next);
         idx = next;
     }
-    queue->root[idx] = element;
+    QUEUE_SET(queue, idx, element, key);
+}
+
+MY_GLOBAL_API void queue_insert(my_queue* queue, unsigned char* element)
+{
+    assert(queue->elements < queue->max_elements);
+    queue_upheap(queue, ++queue->elements, element, QUEUE_KEY(queue, element));
 }
 
 /*
@@ -232,67 +381,134 @@ MY_GLOBAL_API int queue_insert_safe(my_queue* queue, unsigned char* element)
 }
 
 
-	/* Remove item from queue */
-	/* Returns pointer to removed element */
-
-MY_GLOBAL_API unsigned char *queue_remove(my_queue* queue, unsigned int idx)
-{
-    unsigned char *element;
-	
-    assert(idx < queue->max_elements);
-    element = queue->root[++idx];  /* Intern index starts from 1 */
-    queue->root[idx] = queue->root[queue->elements--];
-    _downheap(queue, idx);
-	
-    return element;
-}
-
 	/* Fix when element on top has been replaced */
 
-static void _downheap(my_queue* queue, unsigned int idx)
+static void queue_downheap_binary(my_queue* queue, unsigned int idx)
 {
     unsigned char *element;
-    unsigned int elements, half_queue, offset_to_key, next_index;
+    unsigned long long key;
+    unsigned int elements, half_queue, next_index;
     bool first = TRUE;
     unsigned int start_idx = idx;
     
-    offset_to_key = queue->offset_to_key;
     element = queue->root[idx];
+    key = QUEUE_SLOT_KEY(queue, idx);
     half_queue = (elements = queue->elements) >> 1;    
     while(idx <= half_queue)
     {
         next_index=idx+idx;
         if(next_index < elements &&
-	            (queue->compare(queue->first_cmp_arg,
-	    		 queue->root[next_index]+offset_to_key,
-	    		 queue->root[next_index+1]+offset_to_key) *
-	             queue->max_at_top) > 0)
+           queue_cmp(queue, queue->root[next_index], QUEUE_SLOT_KEY(queue, next_index),
+                     queue->root[next_index+1], QUEUE_SLOT_KEY(queue, next_index+1)) > 0)
             next_index++;
         if(first && 
-                (((queue->compare(queue->first_cmp_arg,
-                 queue->root[next_index]+offset_to_key,
-                 element+offset_to_key) * queue->max_at_top) >= 0)))
+           queue_cmp(queue, queue->root[next_index], QUEUE_SLOT_KEY(queue, next_index),
+                     element, key) >= 0)
         {
-            queue->root[idx]= element;
+            QUEUE_SET(queue, idx, element, key);
             return;
         }
-        queue->root[idx] = queue->root[next_index];
+        QUEUE_MOVE(queue, idx, next_index);
         idx = next_index;
         first = FALSE;
     }    
     next_index = idx >> 1;
     while(next_index > start_idx)
     {
-        if((queue->compare(queue->first_cmp_arg,
-                           queue->root[next_index]+offset_to_key,
-                           element+offset_to_key) *
-                           queue->max_at_top) < 0)
+        if(queue_cmp(queue, queue->root[next_index], QUEUE_SLOT_KEY(queue, next_index),
+                     element, key) < 0)
             break;
-        queue->root[idx]=queue->root[next_index];
+        QUEUE_MOVE(queue, idx, next_index);
         idx=next_index;
         next_index= idx >> 1;
     }
-    queue->root[idx]=element;
+    QUEUE_SET(queue, idx, element, key);
+}
+
+/*
+  _downheap() of a heap with more than 2 children per node: move the
+  element down to the smallest of its children until none is smaller.
+*/
+
+static void queue_downheap_dary(my_queue* queue, unsigned int idx)
+{
+    unsigned char **root = queue->root;
+    unsigned char *element = root[idx];
+    unsigned long long key = QUEUE_SLOT_KEY(queue, idx);
+    unsigned int elements = queue->elements;
+    unsigned int last_parent = QUEUE_PARENT(queue, elements);
+    unsigned int child, last, next_index;
+
+    while (idx <= last_parent)
+    {
+        child = QUEUE_FIRST_CHILD(queue, idx);
+        last = MIN(child + queue_arity(queue) - 1, elements);
+        for (next_index = child++; child <= last; child++)
+        {
+            if (queue_cmp(queue, root[child], QUEUE_SLOT_KEY(queue, child),
+                          root[next_index], QUEUE_SLOT_KEY(queue, next_index)) < 0)
+                next_index = child;
+        }
+        if (queue_cmp(queue, root[next_index], QUEUE_SLOT_KEY(queue, next_index), element, key) >= 0)
+            break;
+        QUEUE_MOVE(queue, idx, next_index);
+        idx = next_index;
+    }
+    QUEUE_SET(queue, idx, element, key);
+}
+
+MY_GLOBAL_API void _downheap(my_queue* queue, unsigned int idx)
+{
+    /* queue_replaced() callers change the element in place, its prefix is stale */
+    if (queue->keys)
+        queue->keys[idx] = QUEUE_KEY(queue, queue->root[idx]);
+    if (queue->arity_shift == 1)
+        queue_downheap_binary(queue, idx);
+    else
+        queue_downheap_dary(queue, idx);
+}
+
+
+/*
+  Move the element in slot idx up or down to its place, after its key
+  changed or it replaced another element
+*/
+
+static void queue_sift(my_queue* queue, unsigned int idx)
+{
+    unsigned char *element = queue->root[idx];
+    unsigned long long key = QUEUE_SLOT_KEY(queue, idx);
+    unsigned int next;
+
+    if (idx > 1 &&
+        (next= QUEUE_PARENT(queue, idx),
+         queue_cmp(queue, element, key, queue->root[next], QUEUE_SLOT_KEY(queue, next))) < 0)
+        queue_upheap(queue, idx, element, key);
+    else
+        _downheap(queue, idx);
+}
+
+
+	/* Remove item from queue */
+	/* Returns pointer to removed element */
+
+MY_GLOBAL_API unsigned char *queue_remove(my_queue* queue, unsigned int idx)
+{
+    unsigned char *element;
+	
+    assert(idx < queue->elements);
+    element = queue->root[++idx];  /* Intern index starts from 1 */
+    QUEUE_MOVE(queue, idx, queue->elements);
+    /*
+      The last element may belong above idx when idx is not on its path,
+      so it moves up or down
+    */
+    if (idx < queue->elements--)
+        queue_sift(queue, idx);
+    if (queue->indexed)
+        QUEUE_SET_POSITION(queue, element, QUEUE_NOT_QUEUED);
+	
+    return element;
 }
 
 /*
@@ -303,7 +519,384 @@ MY_GLOBAL_API void queue_fix(my_queue* queue)
 {
     unsigned int i;
 	
-    for (i= queue->elements >> 1; i > 0; i--)
+    for (i= QUEUE_PARENT(queue, queue->elements); i > 0; i--)
         _downheap(queue, i);
 }
 
+
+
+/*
+  Copy count elements to the slots after the last element, with their
+  key prefixes, without ordering them
+*/
+
+static void queue_append(my_queue* queue, unsigned char** elements, unsigned int count)
+{
+    unsigned int i, idx = queue->elements + 1;
+
+    if (queue->keys || queue->indexed)
+    {
+        for (i = 0; i < count; i++)
+            QUEUE_SET(queue, idx + i, elements[i], QUEUE_KEY(queue, elements[i]));
+    }
+    else
+        memcpy(queue->root + idx, elements, (size_t) count * sizeof(void*));
+    queue->elements += count;
+}
+
+
+/*
+  Make room for count more elements, like queue_insert_safe()
+*/
+
+static int queue_reserve(my_queue* queue, unsigned int count)
+{
+    unsigned int wanted;
+
+    if (count <= queue->max_elements - queue->elements)
+        return 0;
+    if (!queue->auto_extent)
+        return 2;
+    if (count > UINT_MAX - 1 - queue->elements)
+        return 1;
+    wanted = queue->elements + count;
+    if (queue->max_elements < UINT_MAX - 1 - queue->auto_extent)
+        wanted = MAX(wanted, queue->max_elements + queue->auto_extent);
+    return queue_resize(queue, wanted);
+}
+
+
+/*
+  Insert a batch of elements
+
+  SYNOPSIS
+    queue_insert_many()
+    queue		Queue
+    elements		Elements to insert
+    count		Number of elements
+
+  DESCRIPTION
+    The elements are appended to root, then the heap is repaired either
+    by sifting up each new element, O(count * log(n)) in the worst case,
+    or by queue_fix(), O(n). queue_fix() is used when the batch is large
+    compared to the queue: count * log2(n) > 2 * n, where 2 * n bounds
+    the comparisons of the bottom up rebuild.
+
+  RETURN
+    0	ok
+    1	Cannot allocate more memory
+    2	The queue is full and auto_extent is 0, nothing was inserted
+*/
+
+MY_GLOBAL_API int queue_insert_many(my_queue* queue, unsigned char** elements, unsigned int count)
+{
+    unsigned int i, total;
+    int error;
+
+    if (!count)
+        return 0;
+    if ((error = queue_reserve(queue, count)))
+        return error;
+    total = queue->elements + count;
+    if ((unsigned long long) count * my_bit_log2(total) > 2ULL * total)
+    {
+        queue_append(queue, elements, count);
+        queue_fix(queue);
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+            queue_insert(queue, elements[i]);
+    }
+    return 0;
+}
+
+
+/*
+  Replace the content of the queue with elements and heapify them
+
+  SYNOPSIS
+    queue_build()
+    queue		Queue
+    elements		Elements of the new queue, in any order
+    count		Number of elements, the queue grows to hold them
+
+  NOTES
+    Runs in O(count), unlike count calls of queue_insert().
+
+  RETURN
+    0	ok
+    1	Cannot allocate more memory, the queue is unchanged
+*/
+
+MY_GLOBAL_API int queue_build(my_queue* queue, unsigned char** elements, unsigned int count)
+{
+    if (count > queue->max_elements && queue_resize(queue, count))
+        return 1;
+    queue->elements = 0;
+    queue_append(queue, elements, count);
+    queue_fix(queue);
+    return 0;
+}
+
+
+/*
+  Keep a key prefix of each element in the queue
+
+  SYNOPSIS
+    queue_set_key_prefix()
+    queue		Queue
+    key_prefix		Function returning the prefix of the key at
+                        element + offset_to_key, NULL to stop using
+                        prefixes
+
+  DESCRIPTION
+    The prefix of each element is computed once, when it is inserted,
+    and kept in an array next to root with the same layout. Comparisons
+    look at the prefixes first and call compare only when they are
+    equal, so most steps of queue_insert() and _downheap() do not touch
+    the elements at all.
+
+    The prefix must agree with compare: if compare(a, b) < 0 then
+    key_prefix(a) <= key_prefix(b), as unsigned numbers. For integer keys
+    this is the key itself (with the sign bit flipped for signed keys),
+    for strings the first 8 bytes read big endian.
+
+    Prefixes of the elements in the queue are computed here. The top
+    may be changed or replaced in place and fixed with queue_replaced(),
+    which computes its prefix again. Any other element whose key changes
+    must be removed and inserted again, or given to queue_update() in an
+    indexed queue.
+
+  RETURN
+    0	ok
+    1	Could not allocate memory, the queue is unchanged
+*/
+
+MY_GLOBAL_API int queue_set_key_prefix(my_queue* queue, queue_key_prefix key_prefix)
+{
+    unsigned int idx;
+
+    if (!key_prefix)
+    {
+        queue_free_slots(queue->keys, sizeof(unsigned long long));
+        queue->keys = NULL;
+        queue->key_prefix = NULL;
+        return 0;
+    }
+    if (!queue->keys &&
+        !(queue->keys = (unsigned long long*) queue_alloc_slots(NULL, queue->max_elements,
+                                                                 sizeof(unsigned long long))))
+        return 1;
+    queue->key_prefix = key_prefix;
+    for (idx = 1; idx <= queue->elements; idx++)
+        queue->keys[idx] = QUEUE_KEY(queue, queue->root[idx]);
+    return 0;
+}
+
+
+/*
+  Record the position of each element in the element
+
+  SYNOPSIS
+    queue_set_indexed()
+    queue		Queue
+    offset_to_pos	Offset of an unsigned int in the elements, where the
+                        queue stores the index of the element, as given to
+                        queue_remove(). It is QUEUE_NOT_QUEUED once the
+                        element is removed.
+
+  DESCRIPTION
+    With the position in the element, queue_update() and
+    queue_remove_element() find an element without a search and run in
+    O(log n). Every move of an element writes its position, so the
+    elements must stay writable while they are in the queue.
+    queue_remove_all() does not reset the positions.
+*/
+
+MY_GLOBAL_API void queue_set_indexed(my_queue* queue, unsigned int offset_to_pos)
+{
+    unsigned int idx;
+
+    queue->offset_to_pos = offset_to_pos;
+    queue->indexed = TRUE;
+    for (idx = 1; idx <= queue->elements; idx++)
+        QUEUE_SET_POSITION(queue, queue->root[idx], idx - 1);
+}
+
+
+/*
+  Restore the order after the key of an element changed
+
+  SYNOPSIS
+    queue_update()
+    queue		Indexed queue
+    element		Element in the queue whose key changed
+
+  NOTES
+    The element moves up or down, like a decrease-key or increase-key.
+*/
+
+MY_GLOBAL_API void queue_update(my_queue* queue, unsigned char* element)
+{
+    unsigned int idx = queue_position(queue, element) + 1;
+
+    assert(queue->indexed && idx <= queue->elements && queue->root[idx] == element);
+    if (queue->keys)
+        queue->keys[idx] = QUEUE_KEY(queue, element);
+    queue_sift(queue, idx);
+}
+
+
+/*
+  Remove an element from an indexed queue
+
+  RETURN
+    The element
+*/
+
+MY_GLOBAL_API unsigned char* queue_remove_element(my_queue* queue, unsigned char* element)
+{
+    assert(queue->indexed && queue_is_queued(queue, element));
+    return queue_remove(queue, queue_position(queue, element));
+}
+
+
+/*
+  Replace the element on top
+
+  SYNOPSIS
+    queue_replace_top()
+    queue		Queue, not empty
+    element		New element
+
+  NOTES
+    One _downheap() pass, where queue_remove() followed by
+    queue_insert() needs two.
+
+  RETURN
+    The element that was on top
+*/
+
+MY_GLOBAL_API unsigned char* queue_replace_top(my_queue* queue, unsigned char* element)
+{
+    unsigned char* top = queue->root[1];
+
+    assert(queue->elements > 0);
+    if (queue->indexed)
+        QUEUE_SET_POSITION(queue, top, QUEUE_NOT_QUEUED);
+    QUEUE_SET(queue, 1, element, QUEUE_KEY(queue, element));
+    _downheap(queue, 1);
+    return top;
+}
+
+
+/*
+  Offer an element to a queue keeping the max_elements best elements
+
+  SYNOPSIS
+    queue_offer()
+    queue		Queue of at most max_elements elements
+    element		Candidate
+
+  DESCRIPTION
+    Until the queue is full the element is inserted. Then the top is
+    the threshold: the element replaces it if it would come out of the
+    queue after it, and is rejected otherwise, ties included. To keep
+    the K largest elements, use a queue of K elements with the smallest
+    on top (max_at_top FALSE).
+
+  RETURN
+    NULL	The element was inserted, nothing was evicted
+    pointer	The element evicted from the queue, or element itself if
+                it was rejected
+*/
+
+MY_GLOBAL_API unsigned char* queue_offer(my_queue* queue, unsigned char* element)
+{
+    unsigned long long key;
+
+    if (queue->elements < queue->max_elements)
+    {
+        queue_insert(queue, element);
+        return NULL;
+    }
+    key = QUEUE_KEY(queue, element);
+    if (!queue->elements ||
+        queue_cmp(queue, queue->root[1], QUEUE_SLOT_KEY(queue, 1), element, key) >= 0)
+        return element;
+    return queue_replace_top(queue, element);
+}
+
+
+/*
+  Offer a batch of elements, see queue_offer()
+
+  SYNOPSIS
+    queue_offer_many()
+    queue		Queue of at most max_elements elements
+    elements		Candidates
+    count		Number of candidates
+
+  DESCRIPTION
+    The queue is filled with queue_insert_many(), then each candidate is
+    checked against the current top before touching the heap, so only
+    accepted candidates cost a _downheap() pass. With key prefixes, a
+    candidate whose prefix is worse than the prefix of the top is
+    rejected without calling compare.
+
+  RETURN
+    Number of elements accepted. Evicted and rejected elements are not
+    reported.
+*/
+
+MY_GLOBAL_API unsigned int queue_offer_many(my_queue* queue, unsigned char** elements, unsigned int count)
+{
+    unsigned int i, fill, accepted;
+    unsigned long long key;
+    unsigned long long top_key;
+
+    fill = MIN(count, queue->max_elements - queue->elements);
+    (void) queue_insert_many(queue, elements, fill);    /* Fits, cannot fail */
+    accepted = fill;
+    if (!queue->elements)
+        return accepted;
+    top_key = QUEUE_SLOT_KEY(queue, 1);
+    for (i = fill; i < count; i++)
+    {
+        key = QUEUE_KEY(queue, elements[i]);
+        if (queue_cmp(queue, queue->root[1], top_key, elements[i], key) >= 0)
+            continue;
+        queue_replace_top(queue, elements[i]);
+        top_key = QUEUE_SLOT_KEY(queue, 1);
+        accepted++;
+    }
+    return accepted;
+}
+
+
+/*
+  Empty the queue in order
+
+  SYNOPSIS
+    queue_drain_sorted()
+    queue		Queue
+    to			Array of at least elements pointers
+
+  DESCRIPTION
+    Removes the elements in the order queue_top() would return them,
+    to[0] is the top. For a top K queue of the K largest elements, to[]
+    is ascending and the largest element is last.
+
+  RETURN
+    Number of elements stored in to
+*/
+
+MY_GLOBAL_API unsigned int queue_drain_sorted(my_queue* queue, unsigned char** to)
+{
+    unsigned int i, count = queue->elements;
+
+    for (i = 0; i < count; i++)
+        to[i] = queue_remove(queue, 0);
+    return count;
+}
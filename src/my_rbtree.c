@@ -53,6 +53,11 @@
   ft_boolean_search.c (at least) relies on that.
 */
 
+#include <string.h>
+
+#include "my_malloc.h"
+#include "my_alloc.h"
+#include "my_mem_pool.h"
 #include "my_rbtree.h"
 
 
@@ -90,6 +95,13 @@ MY_GLOBAL_API int rbtree_init(rbtree* tree, unsigned long default_alloc_size, un
     tree->null_element.colour = BLACK;
     tree->null_element.left = tree->null_element.right = NULL;
     tree->flag = 0;
+    tree->pool = NULL;
+    if (memory_limit)
+    {
+        /* Owner gets a soft signal at 7/8 of the limit, inserts stop at the limit */
+        my_mem_pool_init(&tree->own_pool, "rbtree", memory_limit - memory_limit / 8, memory_limit);
+        tree->pool = &tree->own_pool;
+    }
     if (!free_element && size >= 0 && ((unsigned int) size <= sizeof(void*) || ((unsigned int)size & (sizeof(void*) - 1))))
     {
         /*
@@ -111,13 +123,24 @@ MY_GLOBAL_API int rbtree_init(rbtree* tree, unsigned long default_alloc_size, un
     }
     if (!(tree->is_delete = is_delete))
     {
-        init_alloc_root(key_memory_rbtree, &tree->mem_root, (unsigned int)default_alloc_size, 0);
+        init_alloc_root(MY_MEM_RBTREE, &tree->mem_root, (size_t) default_alloc_size, 0);
         tree->mem_root.min_malloc = (sizeof(rbtree_element) + tree->size);
     }
     return 0;
 }
 
-static void rbtree_free(rbtree* tree)
+/*
+  Release all elements of the tree
+
+  SYNOPSIS
+    rbtree_free()
+      tree		Tree to empty
+      free_flags	Flags passed on to free_root(). With
+			MY_MARK_BLOCKS_FREE the arena blocks are kept and
+			reused by the next inserts.
+*/
+
+static void rbtree_free(rbtree* tree, int free_flags)
 {
     if (tree->root)				/* If initialized */
     {
@@ -133,23 +156,62 @@ static void rbtree_free(rbtree* tree)
                 if (tree->memory_limit)
                     (*tree->free)(NULL, FREE_UNINIT, tree->context);
             }
-            free_root(&tree->mem_root);
+            free_root(&tree->mem_root, free_flags);
         }
     }
+    if (tree->pool)
+        my_mem_pool_release(tree->pool, tree->allocated);
     tree->root = &tree->null_element;
     tree->elements = 0;
     tree->allocated = 0;
+    tree->flag &= ~rbtree_LIMIT_REACHED;
 }
 
 MY_GLOBAL_API void rbtree_uninit(rbtree* tree)
 {
-    rbtree_free(tree); /* my_free() mem_root if applicable */
+    rbtree_free(tree, 0); /* my_free() mem_root if applicable */
+    if (tree->pool == &tree->own_pool)
+        my_mem_pool_uninit(&tree->own_pool);
+    tree->pool = NULL;
+}
+
+/*
+  Charge the tree to another memory pool
+
+  SYNOPSIS
+    rbtree_set_pool()
+      tree		Tree, should still be empty
+      pool		Pool shared with other containers, NULL for none
+
+  NOTES
+    Replaces the pool rbtree_init() created for memory_limit. Several
+    trees can share one budget this way, and the owner installs its
+    pressure callback with my_mem_pool_set_pressure() on tree->pool.
+
+    Memory the tree already holds is charged to the new pool first.
+
+  RETURN
+    0	ok
+    1	The new pool can not take the memory of the tree, the tree
+	keeps its old pool
+*/
+
+MY_GLOBAL_API int rbtree_set_pool(rbtree* tree, my_mem_pool* pool)
+{
+    if (pool && my_mem_pool_reserve(pool, tree->allocated))
+        return 1;
+    if (tree->pool)
+        my_mem_pool_release(tree->pool, tree->allocated);
+    if (tree->pool == &tree->own_pool)
+        my_mem_pool_uninit(&tree->own_pool);
+    tree->pool = pool;
+    return 0;
 }
 
 MY_GLOBAL_API void rbtree_reset(rbtree* tree)
 {
     /* do not free mem_root, just mark blocks as free */
-    rbtree_free(tree);
+    rbtree_free(tree, MY_MARK_BLOCKS_FREE);
 }
 
 
@@ -201,23 +263,40 @@ MY_GLOBAL_API rbtree_element* rbtree_insert(rbtree* tree, void* key, unsigned in
   if (element == &tree->null_element)
   {
     unsigned int alloc_size=sizeof(rbtree_element)+key_size+tree->size;
-    tree->allocated+=alloc_size;
+    unsigned int elements= tree->elements;
 
-    if (tree->memory_limit && tree->elements
-                           && tree->allocated > tree->memory_limit)
+    if (tree->pool)
     {
-      rbtree_reset(tree);
-      return rbtree_insert(tree, key, key_size, context);
+      if (my_mem_pool_reserve(tree->pool, alloc_size))
+      {
+        /*
+          Over budget. The owner was signalled through the pool callback
+          and could not make room: stop growing instead of failing later.
+        */
+        tree->flag|= rbtree_LIMIT_REACHED;
+        return(NULL);
+      }
+      if (tree->elements != elements)
+      {
+        /* The callback flushed the tree, parent path is stale */
+        my_mem_pool_release(tree->pool, alloc_size);
+        return rbtree_insert(tree, key, key_size, context);
+      }
     }
+    tree->allocated+=alloc_size;
 
     key_size+=tree->size;
     if (tree->is_delete)
-      element=(rbtree_element* ) my_malloc(key_memory_rbtree,
-                                         alloc_size, MYF(MY_WME));
+      element=(rbtree_element* ) my_malloc_ex(alloc_size, MY_MEM_RBTREE);
     else
       element=(rbtree_element* ) alloc_root(&tree->mem_root,alloc_size);
     if (!element)
+    {
+      tree->allocated-=alloc_size;
+      if (tree->pool)
+        my_mem_pool_release(tree->pool, alloc_size);
       return(NULL);
+    }
     **parent=element;
     element->left=element->right= &tree->null_element;
     if (!tree->offset)
@@ -306,6 +385,8 @@ MY_GLOBAL_API int rbtree_delete(rbtree* tree, void* key, unsigned int key_size,
   if (tree->free)
     (*tree->free)(ELEMENT_KEY(tree,element), FREE_FREE, tree->context);
   tree->allocated-= sizeof(rbtree_element) + tree->size + key_size;
+  if (tree->pool)
+    my_mem_pool_release(tree->pool, sizeof(rbtree_element) + tree->size + key_size);
   my_free(element);
   tree->elements--;
   return 0;
@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Vectorized scans.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  All scans work on blocks of SCAN_BLOCK elements: a kernel compares the
+  fields of a block with the value and returns one bit per element, the
+  driver turns the bits into the first match, a count or row indexes.
+
+  Kernels, selected once per scan from the instruction set detected at
+  run time:
+
+    scan_block_avx2	Packed fields (stride == width), all widths
+    scan_block_sse2	Packed fields, all widths except 64 bit < and >,
+                        which SSE2 can not compare
+    scan_block_gather	Fields of 32 and 64 bits inside bigger elements,
+                        loaded with AVX2 gathers
+    scan_mask_scalar	Everything else, and the last partial block
+
+  Vector compares are signed; unsigned fields are compared after
+  flipping their sign bit, which maps unsigned order onto signed order.
+  NE, LE and GE are EQ, GT and LT with the bits of the block inverted.
+
+  The AVX2 kernels are compiled with a target attribute, so the file
+  does not need -mavx2 and runs on any x86 CPU.
+*/
+
+#include <limits.h>
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_atomic.h"
+#include "my_bit.h"
+#include "my_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86
+#include <immintrin.h>
+#define SCAN_AVX2 __attribute__((target("avx2")))
+#endif
+
+#define SCAN_BLOCK      64  /* Elements per kernel call, one bit each */
+
+#define SCAN_CMP_EQ     0
+#define SCAN_CMP_GT     1   /* field > value */
+#define SCAN_CMP_LT     2   /* field < value */
+
+#define SCAN_FIND       0
+#define SCAN_COUNT      1
+#define SCAN_FILTER     2
+
+typedef struct st_scan_op
+{
+    unsigned int cmp;           /* SCAN_CMP_... */
+    unsigned int is_unsigned;
+    unsigned int width;         /* Bytes, 1, 2, 4 or 8 */
+    size_t stride;              /* Bytes from one field to the next */
+    unsigned long long value;   /* Truncated to width */
+    unsigned long long invert;  /* All ones for NE, LE and GE */
+} scan_op;
+
+typedef unsigned long long (*scan_block_func)(const unsigned char* p, const scan_op* op);
+
+static long long scan_isa_level = -1;
+
+
+/*
+  Compare count (at most 64) fields, one bit per field
+*/
+
+#define SCAN_SCALAR_LOOP(UTYPE, STYPE)                                              \
+    do {                                                                            \
+        UTYPE value = (UTYPE) op->value;                                            \
+        UTYPE field;                                                                \
+        int match;                                                                  \
+        for (idx = 0; idx < count; idx++)                                           \
+        {                                                                           \
+            memcpy(&field, p + idx * op->stride, sizeof(field));                    \
+            if (op->cmp == SCAN_CMP_EQ)                                             \
+                match = field == value;                                             \
+            else if (op->is_unsigned)                                               \
+                match = op->cmp == SCAN_CMP_GT ? field > value : field < value;     \
+            else                                                                    \
+                match = op->cmp == SCAN_CMP_GT ? (STYPE) field > (STYPE) value :    \
+                                                 (STYPE) field < (STYPE) value;     \
+            mask |= (unsigned long long) match << idx;                              \
+        }                                                                           \
+    } while (0)
+
+static unsigned long long scan_mask_scalar(const unsigned char* p, const scan_op* op, size_t count)
+{
+    unsigned long long mask = 0;
+    size_t idx;
+
+    switch (op->width) {
+    case 1:
+        SCAN_SCALAR_LOOP(unsigned char, signed char);
+        break;
+    case 2:
+        SCAN_SCALAR_LOOP(unsigned short, short);
+        break;
+    case 4:
+        SCAN_SCALAR_LOOP(unsigned int, int);
+        break;
+    default:
+        SCAN_SCALAR_LOOP(unsigned long long, long long);
+        break;
+    }
+    return mask;
+}
+
+
+static unsigned long long scan_block_scalar(const unsigned char* p, const scan_op* op)
+{
+    return scan_mask_scalar(p, op, SCAN_BLOCK);
+}
+
+
+#ifdef SCAN_X86
+
+#define SSE2_CMP(W, X, V, C) \
+    ((C) == SCAN_CMP_EQ ? _mm_cmpeq_epi##W((X), (V)) : \
+     (C) == SCAN_CMP_GT ? _mm_cmpgt_epi##W((X), (V)) : _mm_cmpgt_epi##W((V), (X)))
+
+#define SSE2_LOAD(P, BIAS) _mm_xor_si128(_mm_loadu_si128((const __m128i*) (P)), (BIAS))
+
+static unsigned long long scan_block_sse2(const unsigned char* p, const scan_op* op)
+{
+    unsigned long long mask = 0;
+    unsigned int idx;
+    __m128i bias, value, r0, r1;
+
+    switch (op->width) {
+    case 1:
+        bias = _mm_set1_epi8(op->is_unsigned ? (char) 0x80 : 0);
+        value = _mm_xor_si128(_mm_set1_epi8((char) op->value), bias);
+        for (idx = 0; idx < 4; idx++)
+        {
+            r0 = SSE2_CMP(8, SSE2_LOAD(p + idx * 16, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm_movemask_epi8(r0) << (idx * 16);
+        }
+        break;
+    case 2:
+        bias = _mm_set1_epi16(op->is_unsigned ? (short) 0x8000 : 0);
+        value = _mm_xor_si128(_mm_set1_epi16((short) op->value), bias);
+        for (idx = 0; idx < 4; idx++)
+        {
+            r0 = SSE2_CMP(16, SSE2_LOAD(p + idx * 32, bias), value, op->cmp);
+            r1 = SSE2_CMP(16, SSE2_LOAD(p + idx * 32 + 16, bias), value, op->cmp);
+            /* Saturating pack keeps 0 and -1, one byte per element */
+            mask |= (unsigned long long) (unsigned int) _mm_movemask_epi8(_mm_packs_epi16(r0, r1)) << (idx * 16);
+        }
+        break;
+    case 4:
+        bias = _mm_set1_epi32(op->is_unsigned ? (int) 0x80000000 : 0);
+        value = _mm_xor_si128(_mm_set1_epi32((int) op->value), bias);
+        for (idx = 0; idx < 16; idx++)
+        {
+            r0 = SSE2_CMP(32, SSE2_LOAD(p + idx * 16, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(r0)) << (idx * 4);
+        }
+        break;
+    default:
+        /* 64 bit equality only: both halves must be equal */
+        value = _mm_set1_epi64x((long long) op->value);
+        for (idx = 0; idx < 32; idx++)
+        {
+            r0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (p + idx * 16)), value);
+            r0 = _mm_and_si128(r0, _mm_shuffle_epi32(r0, 0xB1));
+            mask |= (unsigned long long) (unsigned int) _mm_movemask_pd(_mm_castsi128_pd(r0)) << (idx * 2);
+        }
+        break;
+    }
+    return mask;
+}
+
+
+#define AVX2_CMP(W, X, V, C) \
+    ((C) == SCAN_CMP_EQ ? _mm256_cmpeq_epi##W((X), (V)) : \
+     (C) == SCAN_CMP_GT ? _mm256_cmpgt_epi##W((X), (V)) : _mm256_cmpgt_epi##W((V), (X)))
+
+#define AVX2_LOAD(P, BIAS) _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (P)), (BIAS))
+
+SCAN_AVX2
+static unsigned long long scan_block_avx2(const unsigned char* p, const scan_op* op)
+{
+    unsigned long long mask = 0;
+    unsigned int idx;
+    __m256i bias, value, r0, r1;
+
+    switch (op->width) {
+    case 1:
+        bias = _mm256_set1_epi8(op->is_unsigned ? (char) 0x80 : 0);
+        value = _mm256_xor_si256(_mm256_set1_epi8((char) op->value), bias);
+        for (idx = 0; idx < 2; idx++)
+        {
+            r0 = AVX2_CMP(8, AVX2_LOAD(p + idx * 32, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm256_movemask_epi8(r0) << (idx * 32);
+        }
+        break;
+    case 2:
+        bias = _mm256_set1_epi16(op->is_unsigned ? (short) 0x8000 : 0);
+        value = _mm256_xor_si256(_mm256_set1_epi16((short) op->value), bias);
+        for (idx = 0; idx < 2; idx++)
+        {
+            r0 = AVX2_CMP(16, AVX2_LOAD(p + idx * 64, bias), value, op->cmp);
+            r1 = AVX2_CMP(16, AVX2_LOAD(p + idx * 64 + 32, bias), value, op->cmp);
+            /* The pack works per 128 bit lane, put the quarters back in order */
+            r0 = _mm256_permute4x64_epi64(_mm256_packs_epi16(r0, r1), 0xD8);
+            mask |= (unsigned long long) (unsigned int) _mm256_movemask_epi8(r0) << (idx * 32);
+        }
+        break;
+    case 4:
+        bias = _mm256_set1_epi32(op->is_unsigned ? (int) 0x80000000 : 0);
+        value = _mm256_xor_si256(_mm256_set1_epi32((int) op->value), bias);
+        for (idx = 0; idx < 8; idx++)
+        {
+            r0 = AVX2_CMP(32, AVX2_LOAD(p + idx * 32, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(r0)) << (idx * 8);
+        }
+        break;
+    default:
+        bias = _mm256_set1_epi64x(op->is_unsigned ? (long long) (1ULL << 63) : 0);
+        value = _mm256_xor_si256(_mm256_set1_epi64x((long long) op->value), bias);
+        for (idx = 0; idx < 16; idx++)
+        {
+            r0 = AVX2_CMP(64, AVX2_LOAD(p + idx * 32, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm256_movemask_pd(_mm256_castsi256_pd(r0)) << (idx * 4);
+        }
+        break;
+    }
+    return mask;
+}
+
+
+SCAN_AVX2
+static unsigned long long scan_block_gather(const unsigned char* p, const scan_op* op)
+{
+    unsigned long long mask = 0;
+    unsigned int idx;
+    __m256i bias, value, r0;
+    __m128i offsets;
+
+    if (op->width == 4)
+    {
+        __m256i offsets8 = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                              _mm256_set1_epi32((int) op->stride));
+        bias = _mm256_set1_epi32(op->is_unsigned ? (int) 0x80000000 : 0);
+        value = _mm256_xor_si256(_mm256_set1_epi32((int) op->value), bias);
+        for (idx = 0; idx < 8; idx++)
+        {
+            r0 = _mm256_i32gather_epi32((const int*) (p + idx * 8 * op->stride), offsets8, 1);
+            r0 = AVX2_CMP(32, _mm256_xor_si256(r0, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(r0)) << (idx * 8);
+        }
+    }
+    else
+    {
+        offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32((int) op->stride));
+        bias = _mm256_set1_epi64x(op->is_unsigned ? (long long) (1ULL << 63) : 0);
+        value = _mm256_xor_si256(_mm256_set1_epi64x((long long) op->value), bias);
+        for (idx = 0; idx < 16; idx++)
+        {
+            r0 = _mm256_i32gather_epi64((const long long*) (p + idx * 4 * op->stride), offsets, 1);
+            r0 = AVX2_CMP(64, _mm256_xor_si256(r0, bias), value, op->cmp);
+            mask |= (unsigned long long) (unsigned int) _mm256_movemask_pd(_mm256_castsi256_pd(r0)) << (idx * 4);
+        }
+    }
+    return mask;
+}
+
+#endif /* SCAN_X86 */
+
+
+static unsigned int scan_detect(void)
+{
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return MY_SCAN_ISA_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return MY_SCAN_ISA_SSE2;
+#endif
+    return MY_SCAN_ISA_SCALAR;
+}
+
+
+/*
+  Instruction set used by the scans, detected on first use
+*/
+
+MY_GLOBAL_API unsigned int my_scan_isa(void)
+{
+    long long isa = my_atomic_load(&scan_isa_level);
+
+    if (isa < 0)
+    {
+        isa = scan_detect();
+        my_atomic_store(&scan_isa_level, isa);
+    }
+    return (unsigned int) isa;
+}
+
+
+/*
+  Restrict the scans to an instruction set, to compare kernels
+
+  RETURN
+    The instruction set now used, isa or less if the CPU lacks it
+*/
+
+MY_GLOBAL_API unsigned int my_scan_set_isa(unsigned int __isa)
+{
+    unsigned int isa = MIN(__isa, scan_detect());
+
+    my_atomic_store(&scan_isa_level, (long long) isa);
+    return isa;
+}
+
+
+static scan_block_func scan_select(const scan_op* op)
+{
+#ifdef SCAN_X86
+    unsigned int isa = my_scan_isa();
+
+    if (op->stride == op->width)
+    {
+        if (isa >= MY_SCAN_ISA_AVX2)
+            return scan_block_avx2;
+        if (isa >= MY_SCAN_ISA_SSE2 && (op->width < 8 || op->cmp == SCAN_CMP_EQ))
+            return scan_block_sse2;
+    }
+    else if (isa >= MY_SCAN_ISA_AVX2 && (op->width == 4 || op->width == 8) &&
+             op->stride <= INT_MAX / SCAN_BLOCK)
+        return scan_block_gather;
+#endif
+    return scan_block_scalar;
+}
+
+
+static size_t scan_run(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                       unsigned int __op, unsigned long long __value, int mode, unsigned int* rows)
+{
+    const unsigned char* p = (const unsigned char*) __base;
+    scan_block_func block;
+    scan_op op;
+    unsigned long long mask;
+    size_t idx, found = 0;
+
+    if (__width != 1 && __width != 2 && __width != 4 && __width != 8)
+        return mode == SCAN_FIND ? __total : 0;
+    op.width = __width;
+    op.stride = __stride;
+    op.is_unsigned = (__op & MY_SCAN_UNSIGNED) != 0;
+    op.value = __width == 8 ? __value : __value & ((1ULL << (__width * 8)) - 1);
+    switch (__op & ~MY_SCAN_UNSIGNED) {
+    case MY_SCAN_NE: op.cmp = SCAN_CMP_EQ; op.invert = ~0ULL; break;
+    case MY_SCAN_LT: op.cmp = SCAN_CMP_LT; op.invert = 0; break;
+    case MY_SCAN_GE: op.cmp = SCAN_CMP_LT; op.invert = ~0ULL; break;
+    case MY_SCAN_GT: op.cmp = SCAN_CMP_GT; op.invert = 0; break;
+    case MY_SCAN_LE: op.cmp = SCAN_CMP_GT; op.invert = ~0ULL; break;
+    default:         op.cmp = SCAN_CMP_EQ; op.invert = 0; break;
+    }
+    block = scan_select(&op);
+
+    for (idx = 0; idx < __total; idx += SCAN_BLOCK, p += SCAN_BLOCK * __stride)
+    {
+        if (__total - idx >= SCAN_BLOCK)
+            mask = (*block)(p, &op) ^ op.invert;
+        else
+            mask = (scan_mask_scalar(p, &op, __total - idx) ^ op.invert) &
+                   ((1ULL << (__total - idx)) - 1);
+        if (!mask)
+            continue;
+        switch (mode) {
+        case SCAN_FIND:
+            return idx + my_bit_ctz_64(mask);
+        case SCAN_COUNT:
+            found += my_bit_count_64(mask);
+            break;
+        default:
+            do
+            {
+                rows[found++] = (unsigned int) (idx + my_bit_ctz_64(mask));
+                mask &= mask - 1;
+            } while (mask);
+        }
+    }
+    return mode == SCAN_FIND ? __total : found;
+}
+
+
+/*
+  Find the first element whose field compares to a value
+
+  SYNOPSIS
+    my_scan_find()
+      base	Field of the first element
+      total	Number of elements
+      stride	Bytes between two fields, the element size
+      width	Size of the field, 1, 2, 4 or 8 bytes, in host byte order
+      op	MY_SCAN_EQ ... MY_SCAN_GE, or'ed with MY_SCAN_UNSIGNED
+      value	Value to compare to, truncated to width
+
+  RETURN
+    Index of the first element where field op value holds, total if none
+*/
+
+MY_GLOBAL_API size_t my_scan_find(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                                  unsigned int __op, unsigned long long __value)
+{
+    return scan_run(__base, __total, __stride, __width, __op, __value, SCAN_FIND, NULL);
+}
+
+
+/*
+  Count the elements whose field compares to a value, see my_scan_find()
+*/
+
+MY_GLOBAL_API size_t my_scan_count(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                                   unsigned int __op, unsigned long long __value)
+{
+    return scan_run(__base, __total, __stride, __width, __op, __value, SCAN_COUNT, NULL);
+}
+
+
+/*
+  Collect the indexes of the elements whose field compares to a value
+
+  SYNOPSIS
+    my_scan_filter()
+      rows	Receives the indexes, in increasing order. Must have room
+                for total indexes, total must fit in an unsigned int.
+      Other arguments as for my_scan_find()
+
+  RETURN
+    Number of indexes stored
+*/
+
+MY_GLOBAL_API size_t my_scan_filter(const void* __base, size_t __total, size_t __stride, unsigned int __width,
+                                    unsigned int __op, unsigned long long __value, unsigned int* __rows)
+{
+    return scan_run(__base, __total, __stride, __width, __op, __value, SCAN_FILTER, __rows);
+}
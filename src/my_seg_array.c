@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Segmented array.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  my_seg_array has the interface of my_array, but growing it allocates a
+  new segment as big as everything allocated so far instead of
+  reallocating the buffer. Elements are never copied by growth and their
+  addresses stay valid until the array is freed, so callers can keep
+  pointers returned by my_seg_array_alloc() instead of indexes.
+
+  The price is one more indirection and a bit scan per indexed access,
+  and elements are only contiguous within a segment.
+*/
+
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_seg_array.h"
+
+/* Number of elements in segment */
+#define SEGMENT_NUMBER(array, segment) \
+    ((segment) ? 1U << ((array)->shift + (segment) - 1) : 1U << (array)->shift)
+
+/* Number of segments allocated */
+#define SEGMENTS_USED(array) \
+    ((array)->number ? my_bit_log2((array)->number >> (array)->shift) + 1 : 0)
+
+
+/*
+  Initiate segmented array
+
+  SYNOPSIS
+    my_seg_array_init()
+      number	Expected number of elements, sets the size of segment 0
+      size	Size of element
+
+  RETURN VALUE
+    pointer	Ok, free it with my_seg_array_uninit() and my_free()
+    NULL	Out of memory
+*/
+
+MY_GLOBAL_API my_seg_array* my_seg_array_init(unsigned int __number, unsigned int __size)
+{
+    my_seg_array* array;
+
+    if (!(array = my_malloc_padded_ex(sizeof(my_seg_array), MY_MEM_ARRAY)))
+        return NULL;
+    memset(array, 0, sizeof(my_seg_array));
+    array->size = __size;
+    __number = MIN(MAX(__number, 1U << MY_SEG_ARRAY_MIN_SHIFT), 1U << 30);
+    array->shift = my_bit_log2(my_round_up_to_next_power(__number));
+    if (my_seg_array_reserve(array, 1))
+    {
+        my_free(array);
+        return NULL;
+    }
+    return array;
+}
+
+
+/*
+  Free all segments
+
+  SYNOPSIS
+    my_seg_array_uninit()
+      array	Array to be deleted
+*/
+
+MY_GLOBAL_API void my_seg_array_uninit(my_seg_array* __array)
+{
+    unsigned int segment;
+
+    for (segment = 0; segment < MY_SEG_ARRAY_SEGMENTS; segment++)
+    {
+        my_free(__array->segments[segment]);
+        __array->segments[segment] = NULL;
+    }
+    __array->elements = 0;
+    __array->number = 0;
+}
+
+
+/*
+  Make room for a number of elements
+
+  SYNOPSIS
+    my_seg_array_reserve()
+      array
+      number	Number of elements the array must be able to hold
+
+  DESCRIPTION
+    Allocates segments until number elements fit. Existing elements
+    are not touched.
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	Out of memory, or more than 2^31 elements
+*/
+
+MY_GLOBAL_API int my_seg_array_reserve(my_seg_array* __array, unsigned int __number)
+{
+    unsigned int segment;
+
+    while (__number > __array->number)
+    {
+        segment = SEGMENTS_USED(__array);
+        if (__array->shift + segment >= sizeof(unsigned int) * 8)
+            return 1;
+        if (!(__array->segments[segment] = (unsigned char*)
+              my_malloc_ex((size_t) SEGMENT_NUMBER(__array, segment) * __array->size, MY_MEM_ARRAY)))
+            return 1;
+        __array->number = 1U << (__array->shift + segment);
+    }
+    return 0;
+}
+
+
+/*
+  Copy or clear elements idx..idx+count-1, segment by segment
+
+  SYNOPSIS
+    seg_array_fill()
+      array
+      idx	First element, below number
+      from	Elements to copy, NULL to zero the elements
+      count	Number of elements, idx + count at most number
+*/
+
+static void seg_array_fill(my_seg_array* __array, unsigned int __idx,
+                           const unsigned char* __from, unsigned int __count)
+{
+    unsigned int segment, offset, part;
+    unsigned char* to;
+
+    while (__count)
+    {
+        segment = my_seg_array_segment(__array, __idx, &offset);
+        part = MIN(__count, SEGMENT_NUMBER(__array, segment) - offset);
+        to = __array->segments[segment] + (size_t) offset * __array->size;
+        if (__from)
+        {
+            memcpy(to, __from, (size_t) part * __array->size);
+            __from += (size_t) part * __array->size;
+        }
+        else
+            memset(to, 0, (size_t) part * __array->size);
+        __idx += part;
+        __count -= part;
+    }
+}
+
+
+/*
+  Alloc space for next element
+
+  RETURN VALUE
+    pointer	Pointer to empty space for element, stays valid until the
+                element is popped or the array freed
+    0		Error
+*/
+
+MY_GLOBAL_API void* my_seg_array_alloc(my_seg_array* __array)
+{
+    if (__array->elements == __array->number &&
+        my_seg_array_reserve(__array, __array->elements + 1))
+        return NULL;
+    return my_seg_array_element(__array, __array->elements++);
+}
+
+
+/*
+  Insert element at the end of array
+
+  RETURN VALUE
+    TRUE	Insert failed
+    FALSE	Ok
+*/
+
+MY_GLOBAL_API int my_seg_array_insert(my_seg_array* __array, const void* __element)
+{
+    void* buffer;
+
+    if (!(buffer = my_seg_array_alloc(__array)))
+        return 1;
+    memcpy(buffer, __element, (size_t) __array->size);
+    return 0;
+}
+
+
+/*
+  Append count elements at the end of array
+
+  RETURN VALUE
+    TRUE	Out of memory, the array is unchanged
+    FALSE	Ok
+*/
+
+MY_GLOBAL_API int my_seg_array_append(my_seg_array* __array, const void* __elements, unsigned int __count)
+{
+    if (__count > (unsigned int) -1 - __array->elements ||
+        my_seg_array_reserve(__array, __array->elements + __count))
+        return 1;
+    seg_array_fill(__array, __array->elements, (const unsigned char*) __elements, __count);
+    __array->elements += __count;
+    return 0;
+}
+
+
+MY_GLOBAL_API void* my_seg_array_pop(my_seg_array* __array)
+{
+    if (__array->elements)
+        return my_seg_array_element(__array, --__array->elements);
+    return NULL;
+}
+
+
+/*
+  Get an element from array by given index
+
+  RETURN VALUE
+    FALSE	Ok
+    TRUE	idx out of range, element is zeroed
+*/
+
+MY_GLOBAL_API int my_seg_array_get(my_seg_array* __array, void* __element, unsigned int __idx)
+{
+    if (__idx >= __array->elements)
+    {
+        memset(__element, 0, __array->size);
+        return 1;
+    }
+    memcpy(__element, my_seg_array_element(__array, __idx), (size_t) __array->size);
+    return 0;
+}
+
+
+/*
+  Replace element in array with given element and index
+
+  DESCRIPTION
+    If idx is past the last element the array is extended, elements
+    between the old end and idx are zeroed.
+
+  RETURN VALUE
+    TRUE	Idx was out of range and allocation of new memory failed
+    FALSE	Ok
+*/
+
+MY_GLOBAL_API int my_seg_array_set(my_seg_array* __array, const void* __element, unsigned int __idx)
+{
+    if (__idx >= __array->elements)
+    {
+        if (__idx == (unsigned int) -1 || my_seg_array_reserve(__array, __idx + 1))
+            return 1;
+        seg_array_fill(__array, __array->elements, NULL, __idx - __array->elements);
+        __array->elements = __idx + 1;
+    }
+    memcpy(my_seg_array_element(__array, __idx), __element, (size_t) __array->size);
+    return 0;
+}
+
+
+/*
+  Free unused segments
+
+  NOTES
+    One empty segment is kept past the last element, so an array
+    oscillating around a segment boundary does not allocate and free
+    the same segment again and again.
+*/
+
+MY_GLOBAL_API void my_seg_array_free(my_seg_array* __array)
+{
+    unsigned int offset;
+    unsigned int keep = my_seg_array_segment(__array, MAX(__array->elements, 1) - 1, &offset) + 2;
+    unsigned int segment = SEGMENTS_USED(__array);
+
+    if (segment <= keep)
+        return;
+    while (segment > keep)
+    {
+        segment--;
+        my_free(__array->segments[segment]);
+        __array->segments[segment] = NULL;
+    }
+    __array->number = 1U << (__array->shift + keep - 1);
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2013, Heng Wang personal. All rights reserved.
+ *
+ * Hierarchical timing wheel.
+ *
+ * @Author:  Heng.Wang
+ * @Date  :  12/24/2013
+ * @Email :  wangheng.king@gmail.com
+ *           king_wangheng@163.com
+ * @Github:  https://github.com/HengWang/
+ * @Blog  :  http://hengwang.blog.chinaunix.net
+ * */
+
+/*
+  A replacement of my_queue for timeouts. A heap pays O(log n)
+  comparisons to arm and to cancel a timer, a wheel only links the timer
+  into the list of a slot, which matters when most timers are cancelled
+  before they expire.
+
+  Time is counted in ticks of tick time units. A timer with a delay of
+  d ticks waits at level l, the lowest with d < 1 << ((l + 1) * slot_bits),
+  in the slot of its expiry tick. Each tick, the level 0 slot of the new
+  tick expires; when the low bits of the tick wrap, the matching slot of
+  the level above is emptied and its timers are armed again, which puts
+  them one level lower. A timer is thus moved at most levels - 1 times.
+  Delays beyond the range of the top level wait in its last slot and are
+  placed again when it cascades; with a single level that happens every
+  revolution, so one level only suits bounded delays.
+
+  Timers expire on the first tick at or after their expiry time, never
+  before. The wheel is not thread safe.
+*/
+
+#include <string.h>
+
+#include "my_global_exports.h"
+#include "my_malloc.h"
+#include "my_timer_wheel.h"
+
+#define WHEEL_SLOTS(wheel) (1U << (wheel)->slot_bits)
+#define WHEEL_MASK(wheel) (WHEEL_SLOTS(wheel) - 1)
+
+
+/*
+  Create a timing wheel
+
+  SYNOPSIS
+    my_timer_wheel_init()
+      tick		Time units per tick, 0 for 1
+      levels		Number of levels, 0 for MY_TIMER_WHEEL_LEVELS
+      slot_bits		log2 of slots per level, 0 for
+                        MY_TIMER_WHEEL_SLOT_BITS
+      now		Current time
+
+  DESCRIPTION
+    The wheel covers delays up to 1 << (levels * slot_bits) ticks
+    without moving timers more often. The default, 4 levels of 256
+    slots, covers 2^32 ticks with 1024 slots.
+
+  RETURN VALUE
+    pointer	Ok, free it with my_timer_wheel_uninit() and my_free()
+    NULL	Out of memory, or levels * slot_bits above 62
+*/
+
+MY_GLOBAL_API my_timer_wheel* my_timer_wheel_init(unsigned int __tick, unsigned int __levels,
+                                                  unsigned int __slot_bits, unsigned long long __now)
+{
+    my_timer_wheel* wheel;
+    size_t length;
+
+    __tick = __tick ? __tick : 1;
+    __levels = __levels ? __levels : MY_TIMER_WHEEL_LEVELS;
+    __slot_bits = __slot_bits ? __slot_bits : MY_TIMER_WHEEL_SLOT_BITS;
+    if (__levels > MY_TIMER_WHEEL_MAX_LEVELS || __slot_bits > MY_TIMER_WHEEL_MAX_SLOT_BITS ||
+        __levels * __slot_bits > 62)
+        return NULL;
+    if (!(wheel = my_malloc_padded_ex(sizeof(my_timer_wheel), MY_MEM_QUEUE)))
+        return NULL;
+    length = ((size_t) __levels << __slot_bits) * sizeof(my_timer*);
+    if (!(wheel->slots = (my_timer**) my_malloc_ex(length, MY_MEM_QUEUE)))
+    {
+        my_free(wheel);
+        return NULL;
+    }
+    memset(wheel->slots, 0, length);
+    wheel->current = __now / __tick;
+    wheel->tick = __tick;
+    wheel->levels = __levels;
+    wheel->slot_bits = __slot_bits;
+    wheel->timers = 0;
+    memset(wheel->counts, 0, sizeof(wheel->counts));
+    return wheel;
+}
+
+
+/*
+  Free the slots, timers still armed are disarmed
+*/
+
+MY_GLOBAL_API void my_timer_wheel_uninit(my_timer_wheel* __wheel)
+{
+    size_t slot, slots = (size_t) __wheel->levels << __wheel->slot_bits;
+    my_timer* timer;
+
+    for (slot = 0; slot < slots && __wheel->timers; slot++)
+    {
+        for (timer = __wheel->slots[slot]; timer; timer = timer->next, __wheel->timers--)
+            timer->pprev = NULL;
+    }
+    my_free(__wheel->slots);
+    __wheel->slots = NULL;
+    __wheel->timers = 0;
+    memset(__wheel->counts, 0, sizeof(__wheel->counts));
+}
+
+
+static inline void wheel_link(my_timer_wheel* __wheel, my_timer** __head, my_timer* __timer,
+                              unsigned int __level)
+{
+    if ((__timer->next = *__head))
+        __timer->next->pprev = &__timer->next;
+    __timer->pprev = __head;
+    __timer->level = __level;
+    __wheel->counts[__level]++;
+    *__head = __timer;
+}
+
+
+static inline void wheel_unlink(my_timer_wheel* __wheel, my_timer* __timer)
+{
+    if (__timer->next)
+        __timer->next->pprev = __timer->pprev;
+    *__timer->pprev = __timer->next;
+    __timer->pprev = NULL;
+    __wheel->counts[__timer->level]--;
+}
+
+
+/*
+  Link an unarmed timer, whose expires is after current, in its slot
+*/
+
+static void wheel_add(my_timer_wheel* __wheel, my_timer* __timer)
+{
+    unsigned long long expires = __timer->expires;
+    unsigned long long delta = expires - __wheel->current;
+    unsigned int level, shift = __wheel->slot_bits;
+
+    for (level = 0; level < __wheel->levels - 1 && delta >> shift; level++)
+        shift += __wheel->slot_bits;
+    if (delta >> shift)
+        expires = __wheel->current + (1ULL << shift) - 1;   /* Beyond the wheel */
+    shift -= __wheel->slot_bits;
+    wheel_link(__wheel, &__wheel->slots[(level << __wheel->slot_bits) +
+                                        (unsigned int) ((expires >> shift) & WHEEL_MASK(__wheel))],
+               __timer, level);
+}
+
+
+/*
+  Arm a timer
+
+  SYNOPSIS
+    my_timer_wheel_arm()
+      wheel
+      timer	Timer, armed again if it is armed
+      expires	Expiry time, in the units of now. A time already past
+                expires on the next tick.
+*/
+
+MY_GLOBAL_API void my_timer_wheel_arm(my_timer_wheel* __wheel, my_timer* __timer, unsigned long long __expires)
+{
+    unsigned long long ticks = __expires / __wheel->tick + (__expires % __wheel->tick != 0);
+
+    if (__timer->pprev)
+        wheel_unlink(__wheel, __timer);
+    else
+        __wheel->timers++;
+    __timer->expires = MAX(ticks, __wheel->current + 1);
+    wheel_add(__wheel, __timer);
+}
+
+
+/*
+  Disarm a timer, does nothing if it is not armed
+*/
+
+MY_GLOBAL_API void my_timer_wheel_cancel(my_timer_wheel* __wheel, my_timer* __timer)
+{
+    if (!__timer->pprev)
+        return;
+    wheel_unlink(__wheel, __timer);
+    __wheel->timers--;
+}
+
+
+/*
+  Arm again the timers of a slot of level 1 or above
+*/
+
+static void wheel_cascade(my_timer_wheel* __wheel, my_timer** __slot)
+{
+    my_timer* timer = *__slot;
+    my_timer* next;
+
+    *__slot = NULL;
+    for (; timer; timer = next)
+    {
+        next = timer->next;
+        __wheel->counts[timer->level]--;
+        wheel_add(__wheel, timer);
+    }
+}
+
+
+/*
+  Expire the timers of a level 0 slot, in batches
+*/
+
+static unsigned int wheel_expire(my_timer_wheel* __wheel, my_timer** __slot,
+                                 my_timer_expire_func __func, void* __arg)
+{
+    my_timer* batch[MY_TIMER_WHEEL_BATCH];
+    my_timer* pending = NULL;
+    my_timer* timer;
+    unsigned int count, expired = 0;
+
+    /*
+      Move the list to pending, where the expire function may still
+      cancel the timers not expired yet
+    */
+    if (!*__slot)
+        return 0;
+    pending = *__slot;
+    pending->pprev = &pending;
+    *__slot = NULL;
+    while (pending)
+    {
+        for (count = 0; pending && count < MY_TIMER_WHEEL_BATCH;)
+        {
+            wheel_unlink(__wheel, timer = pending);
+            if (timer->expires > __wheel->current)
+                wheel_add(__wheel, timer);      /* Beyond a wheel of one level */
+            else
+                batch[count++] = timer;
+        }
+        if (!count)
+            continue;
+        __wheel->timers -= count;
+        expired += count;
+        __func(__arg, batch, count);
+    }
+    return expired;
+}
+
+
+/*
+  Advance the wheel to now and expire the timers due
+
+  SYNOPSIS
+    my_timer_wheel_advance()
+      wheel
+      now	Current time, in the units of my_timer_wheel_init()
+      func	Called with the expired timers, up to MY_TIMER_WHEEL_BATCH
+                at a time. It may arm or cancel any timer.
+      arg	First argument of func
+
+  NOTES
+    The cost is one step per elapsed tick plus the timers expired or
+    moved down a level. Ticks are skipped up to the next cascade while
+    the levels below it hold no timer.
+
+  RETURN VALUE
+    Number of timers expired
+*/
+
+MY_GLOBAL_API unsigned int my_timer_wheel_advance(my_timer_wheel* __wheel, unsigned long long __now,
+                                                  my_timer_expire_func __func, void* __arg)
+{
+    unsigned long long target = __now / __wheel->tick;
+    unsigned int level, shift, idx, expired = 0;
+
+    while (__wheel->current < target)
+    {
+        if (!__wheel->timers)
+        {
+            __wheel->current = target;
+            break;
+        }
+        /*
+          With the levels below l empty, nothing happens before the
+          next cascade of level l, skip to it
+        */
+        for (level = 0, shift = 0; level < __wheel->levels - 1 && !__wheel->counts[level]; level++)
+            shift += __wheel->slot_bits;
+        if (shift && (__wheel->current | ((1ULL << shift) - 1)) >= target)
+        {
+            __wheel->current = target;
+            break;
+        }
+        if (shift)
+            __wheel->current |= (1ULL << shift) - 1;
+        __wheel->current++;
+        /* Cascade each level whose lower levels wrapped around */
+        for (level = 1, shift = __wheel->slot_bits; level < __wheel->levels; level++, shift += __wheel->slot_bits)
+        {
+            if (__wheel->current & ((1ULL << shift) - 1))
+                break;
+            idx = (unsigned int) ((__wheel->current >> shift) & WHEEL_MASK(__wheel));
+            wheel_cascade(__wheel, &__wheel->slots[(level << __wheel->slot_bits) + idx]);
+        }
+        idx = (unsigned int) (__wheel->current & WHEEL_MASK(__wheel));
+        expired += wheel_expire(__wheel, &__wheel->slots[idx], __func, __arg);
+    }
+    return expired;
+}